@@ -0,0 +1,99 @@
+// std
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+// Root
+#include <TF2.h>
+#include <TFile.h>
+// Throw
+#include "Throw.h"
+
+
+//std
+using std::cout;
+using std::endl;
+
+/**
+ * \brief Typical histogram set: many 1D spectra and a few 2D maps.
+ */
+std::vector<TH1*> makeHistSet() {
+  TH1::AddDirectory(false);
+
+  std::vector<TH1*> histVec;
+  for (int i = 0; i < 2000; ++i) {
+    std::string name = "spectrum_" + std::to_string(i);
+    TH1D* hist = new TH1D(name.c_str(), "Spectrum;x;events", 200, -5, 5);
+    hist->FillRandom("gaus", 10000);
+    histVec.emplace_back(hist);
+  }
+
+  TF2 *gaus2D = new TF2("gaus2D", "xygaus", -10, 10 , -10, 10);
+  gaus2D->SetParameters(1, 0, 2, 0, 2);
+  for (int i = 0; i < 50; ++i) {
+    std::string name = "map_" + std::to_string(i);
+    TH2D* hist = new TH2D(name.c_str(), "Map;x;y", 200, -5, 5, 200, -5, 5);
+    hist->FillRandom("gaus2D", 100000);
+    histVec.emplace_back(hist);
+  }
+  delete gaus2D;
+
+  return histVec;
+}
+
+/**
+ * \brief Write the histogram set with the compression profile and report
+ * throughput and compression ratio.
+ */
+void benchCompression(const std::vector<TH1*>& histVec,
+                      const std::string& profile) {
+  std::string filePath = "benchCompression_" + profile + ".root";
+  for (char& c : filePath) {
+    if (c == ':') {
+      c = '_';
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  Throw::QuickOutSession* session = new Throw::QuickOutSession(profile);
+  for (auto &hist : histVec) {
+    session->write(hist, filePath);
+  }
+  session->close();
+  delete session;
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  TFile* inFile = TFile::Open(filePath.c_str(), "READ");
+  double fileSize = inFile->GetSize() / 1.e6;
+  double ratio = inFile->GetCompressionFactor();
+  inFile->Close();
+  delete inFile;
+
+  cout << std::setw(10) << profile
+       << std::setw(12) << std::fixed << std::setprecision(1)
+       << fileSize * ratio / elapsed.count() << " MB/s"
+       << std::setw(10) << std::setprecision(2) << ratio
+       << std::setw(10) << std::setprecision(1) << fileSize << " MB" << endl;
+}
+
+int main() {
+  std::vector<TH1*> histVec = makeHistSet();
+
+  cout << std::setw(10) << "profile"
+       << std::setw(17) << "throughput"
+       << std::setw(10) << "ratio"
+       << std::setw(13) << "size" << endl;
+  std::vector<std::string> profiles = {"none", "fast", "balanced", "archive",
+                                       "ZLIB:1", "LZMA:5"};
+  for (auto &profile : profiles) {
+    benchCompression(histVec, profile);
+  }
+
+  for (auto &hist : histVec) {
+    delete hist;
+  }
+
+  return 0;
+}
@@ -1,5 +1,20 @@
 // std
 #include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <sstream>
+#include <iterator>
+// Root
+#include <TRandom3.h>
+#include <TFile.h>
+#include <TTree.h>
 // Throw
 #include "Throw.h"
 
@@ -66,6 +81,25 @@ void testPlotter2D() {
   delete testPlotGraph;
 }
 
+void testRasterPlotter() {
+  TF2 *gaus2D = new TF2("gaus2D", "xygaus", -10, 10 , -10, 10);
+  gaus2D->SetParameters(1, 0, 2, 0, 2);
+
+  TH2D* testHist = new TH2D("testHist", "Test Histogram;label x;label y",
+                            200, -5, 8, 200, -5, 8);
+  testHist->FillRandom("gaus2D", 1000 * 1000);
+
+  Plotter2D* testPlot = new Plotter2D("testPlot2Draster");
+  testPlot->addHist(testHist);
+  testPlot->setRasterize(true);
+  testPlot->setRasterDpi(150);
+  testPlot->draw();
+
+  delete gaus2D;
+  delete testHist;
+  delete testPlot;
+}
+
 void testGraphSection() {
   TF2 *gaus2D = new TF2("gaus2D", "xygaus", -10, 10 , -10, 10);
   gaus2D->SetParameters(1, 0, 2, 0, 2);
@@ -91,10 +125,775 @@ void testGraphSection() {
   delete sectionPlot;
 }
 
+void testGraphPyramid() {
+  TGraph* testGraph = new TGraph(1000 * 1000);
+  testGraph->SetName("testGraphPyramid");
+  testGraph->SetTitle("Test Graph;label x;label y");
+  TRandom3 random;
+  for (int i = 0; i < testGraph->GetN(); ++i) {
+    testGraph->SetPoint(i, i, sin(i * 1e-4) + random.Gaus(0., .1));
+  }
+  Throw::GraphPyramid* pyramid = new Throw::GraphPyramid(testGraph);
+  pyramid->write("testGraphPyramid.root");
+  delete pyramid;
+
+  pyramid = new Throw::GraphPyramid("testGraphPyramid.root",
+                                    "testGraphPyramid");
+  cout << "Graph pyramid: " << pyramid->getNlevels() << " levels" << endl;
+
+  // The pyramid has to survive the first draw
+  Plotter1D* testPlot = new Plotter1D("testPlotPyramidWide");
+  testPlot->addPyramid(pyramid);
+  testPlot->draw();
+  testPlot->setOutFilePath("testPlotPyramidZoom");
+  testPlot->setXmin(1000.);
+  testPlot->setXmax(5000.);
+  testPlot->draw();
+  if (testPlot->getGraph(0)) {
+    cout << "Graph pyramid: ERROR, window stored in the plotter!" << endl;
+  }
+
+  delete testGraph;
+  delete testPlot;
+  delete pyramid;
+}
+
+void testPrintHist() {
+  TH1D* testHist = new TH1D("testHist", "Test Histogram;label x;label y",
+                            1000 * 1000, -5, 8);
+  testHist->FillRandom("gaus", 1000 * 1000);
+  Throw::PrintHist(testHist, "testPrintHist.tsv");
+  Throw::PrintHist(testHist, "testPrintHist.csv", "CSV");
+
+  TGraph2D* testGraph = new TGraph2D(3);
+  testGraph->SetPoint(0, 0.1, 0.2, 0.3);
+  testGraph->SetPoint(1, 1.1, 1.2, 1.3);
+  testGraph->SetPoint(2, 2.1, 2.2, 2.3);
+  Throw::PrintGraph(testGraph, "testPrintGraph2D.tsv");
+
+  delete testHist;
+  delete testGraph;
+}
+
+void testQuickOutAsync() {
+  std::vector<std::future<bool>> results;
+  for (int i = 0; i < 2000; ++i) {
+    TH1D* testHist = new TH1D(("testHistAsync" + std::to_string(i)).c_str(),
+                              "Test Histogram;label x;label y", 20, -5, 8);
+    testHist->Fill(i % 20 - 5);
+    results.emplace_back(Throw::QuickOutAsync(testHist, "testQuickOutAsync"));
+  }
+
+  // More files than the writer keeps open, files are reopened for update
+  Throw::AsyncWriter writer(64);
+  for (int i = 0; i < 3000; ++i) {
+    TH1D* testHist = new TH1D(("testHistWriter" + std::to_string(i)).c_str(),
+                              "Test Histogram;label x;label y", 20, -5, 8);
+    std::string filePath = "testAsyncWriter/testAsyncWriter" +
+                           std::to_string(i % 40) + ".root";
+    results.emplace_back(writer.write(testHist, filePath));
+  }
+  writer.shutdown();
+  Throw::ShutdownQuickOutAsync();
+
+  int nWritten = 0;
+  for (auto &result : results) {
+    if (result.get()) {
+      ++nWritten;
+    }
+  }
+  cout << "Async writer: " << nWritten << " of " << results.size()
+       << " objects written" << endl;
+}
+
+void testLoadObjects() {
+  std::vector<std::string> filePaths;
+  Throw::QuickOutSession* session = new Throw::QuickOutSession();
+  for (int i = 0; i < 4; ++i) {
+    TH1D* testHist = new TH1D("testHistLoad", "Test Histogram;label x;label y",
+                              20, -5, 8);
+    testHist->Fill(i);
+    filePaths.emplace_back("testLoadObjects/testLoadObjects" +
+                           std::to_string(i) + ".root");
+    session->write(testHist, filePaths.back());
+    delete testHist;
+  }
+  session->close();
+  delete session;
+
+  std::map<std::string, std::vector<TObject*>> objectMap =
+      Throw::LoadObjects(filePaths, {"testHist*"});
+  std::vector<TObject*>& objects = objectMap["testHistLoad"];
+  cout << "Object loader: " << objects.size() << " of " << filePaths.size()
+       << " histograms loaded" << endl;
+
+  Plotter1D* testPlot = new Plotter1D("testPlotLoadObjects");
+  for (auto &object : objects) {
+    testPlot->addHist(dynamic_cast<TH1D*>(object));
+  }
+  testPlot->draw();
+
+  for (auto &object : objects) {
+    delete object;
+  }
+  delete testPlot;
+}
+
+void testMergeFiles() {
+  // More names than merged in one pass and an odd number of threads
+  std::vector<std::string> filePaths;
+  Throw::QuickOutSession* session = new Throw::QuickOutSession();
+  for (int i = 0; i < 3; ++i) {
+    filePaths.emplace_back("testMergeFiles/testMergeFiles" +
+                           std::to_string(i) + ".root");
+    for (int j = 0; j < 20; ++j) {
+      std::string name = "testHistMerge" + std::to_string(j);
+      TH1D* testHist = new TH1D(name.c_str(),
+                                "Test Histogram;label x;label y", 20, -5, 8);
+      testHist->FillRandom("gaus", 1000);
+      session->write(testHist, filePaths.back());
+      delete testHist;
+    }
+  }
+  session->close();
+  delete session;
+
+  bool merged = Throw::MergeFiles(filePaths, "testMergeFiles/testMerged.root",
+                                  3);
+  std::map<std::string, std::vector<TObject*>> objectMap =
+      Throw::LoadObjects({"testMergeFiles/testMerged.root"}, {"testHist*"});
+  size_t nMerged = 0;
+  for (auto &entry : objectMap) {
+    for (TObject* object : entry.second) {
+      TH1D* mergedHist = dynamic_cast<TH1D*>(object);
+      if (mergedHist && mergedHist->GetEntries() == 3000.) {
+        ++nMerged;
+      }
+      delete object;
+    }
+  }
+  cout << "Merge files: " << (merged ? "merged" : "failed") << ", complete "
+       << "histograms: " << nMerged << " / 20" << endl;
+}
+
+void testSplitView() {
+  // Edge cases of std::getline and delimiters around the SIMD block sizes
+  std::vector<std::string> inputs = {"", ",", "a", "a,", ",a", "a,,b", ",,"};
+  for (size_t length : {15, 16, 17, 31, 32, 33}) {
+    for (size_t position : {size_t(0), size_t(14), size_t(15), size_t(16),
+                            size_t(30), size_t(31), size_t(32), length - 1}) {
+      std::string input(length, 'x');
+      if (position < length) {
+        input[position] = ',';
+      }
+      inputs.emplace_back(input);
+      input.back() = ';';
+      inputs.emplace_back(input);
+    }
+    inputs.emplace_back(std::string(length, 'x'));
+    inputs.emplace_back(std::string(length, ','));
+  }
+
+  size_t nMatching = 0;
+  size_t nCases = 0;
+  for (auto &input : inputs) {
+    for (std::string delimiters : {",", ",; "}) {
+      std::string replaced = input;
+      for (char &c : replaced) {
+        if (delimiters.find(c) != std::string::npos) {
+          c = '\n';
+        }
+      }
+      std::vector<std::string_view> expected;
+      std::vector<std::string> lines;
+      std::istringstream stream(replaced);
+      for (std::string line; std::getline(stream, line);) {
+        lines.emplace_back(line);
+      }
+      size_t begin = 0;
+      for (auto &line : lines) {
+        expected.emplace_back(std::string_view(input).substr(begin,
+                                                             line.size()));
+        begin += line.size() + 1;
+      }
+
+      Throw::SplitView view(input, delimiters);
+      std::vector<std::string_view> tokens(view.begin(), view.end());
+      if (tokens == expected &&
+          std::distance(view.begin(), view.end()) ==
+          static_cast<std::ptrdiff_t>(expected.size())) {
+        ++nMatching;
+      }
+      ++nCases;
+    }
+  }
+  cout << "Split view: " << nMatching << " / " << nCases
+       << " cases match std::getline" << endl;
+}
+
+void testInternedString() {
+  // Every thread interns its own copies of the same strings
+  const size_t nThreads = 8;
+  const size_t nStrings = 1000;
+  std::vector<std::vector<const char*>> pointers(
+      nThreads, std::vector<const char*>(nStrings));
+  std::vector<std::vector<size_t>> hashes(nThreads,
+                                          std::vector<size_t>(nStrings));
+  std::vector<std::thread> threadVec;
+  for (size_t t = 0; t < nThreads; ++t) {
+    threadVec.emplace_back([&, t]() {
+      for (size_t i = 0; i < nStrings; ++i) {
+        std::string str = "testInterned" + std::to_string((i + t) % nStrings);
+        Throw::InternedString handle(str);
+        size_t index = (i + t) % nStrings;
+        pointers.at(t).at(index) = handle.c_str();
+        hashes.at(t).at(index) = handle.hash();
+      }
+    });
+  }
+  for (auto &thread : threadVec) {
+    thread.join();
+  }
+
+  std::set<const char*> distinct(pointers.front().begin(),
+                                 pointers.front().end());
+  bool isSame = distinct.size() == nStrings;
+  for (size_t t = 1; t < nThreads; ++t) {
+    isSame = isSame && pointers.at(t) == pointers.front() &&
+             hashes.at(t) == hashes.front();
+  }
+  isSame = isSame && Throw::InternedString("testInterned7").c_str() ==
+                     pointers.front().at(7);
+  cout << "Interned string: " << distinct.size() << " distinct strings, "
+       << (isSame ? "same" : "different") << " handles in " << nThreads
+       << " threads" << endl;
+}
+
+void testInputParser() {
+  std::ofstream responseFile("testInputParser.rsp");
+  responseFile << "--bins=20 -x 1.5\n\t--name  hist\n";
+  responseFile.close();
+
+  std::vector<std::string> args = {"testInputParser", "--opt=value", "-n",
+                                   "42", "--bad", "4x2",
+                                   "@testInputParser.rsp"};
+  std::vector<char*> argv;
+  for (auto &arg : args) {
+    argv.emplace_back(&arg[0]);
+  }
+  int argc = argv.size();
+  Throw::InputParser parser(argc, argv.data());
+
+  int nValue = 0;
+  size_t bins = 0;
+  double x = 0.;
+  parser.getCmdOption("-n", nValue);
+  parser.getCmdOption("--bins", bins);
+  parser.getCmdOption("-x", x);
+  std::string badValue = "accepted";
+  try {
+    int bad = 0;
+    parser.getCmdOption("--bad", bad);
+  } catch (const Throw::Exception& exception) {
+    badValue = exception.what();
+  }
+  cout << "Input parser: --opt " << parser.getCmdOption("--opt") << ", -n "
+       << nValue << ", --bins " << bins << ", -x " << x << ", --name "
+       << parser.getCmdOption("--name") << ", "
+       << parser.getTokens().size() << " tokens, --bad: " << badValue
+       << endl;
+}
+
+void testTime() {
+  // Central European time with the rules of 2026, DST from 29 Mar to 25 Oct
+  const char* oldZone = getenv("TZ");
+  std::string oldZoneValue = oldZone ? oldZone : "";
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+  auto localTime = [](int year, int month, int day, int hour, int minute,
+                      int second) {
+    tm date = {};
+    date.tm_year = year - 1900;
+    date.tm_mon = month - 1;
+    date.tm_mday = day;
+    date.tm_hour = hour;
+    date.tm_min = minute;
+    date.tm_sec = second;
+    date.tm_isdst = -1;
+
+    return mktime(&date);
+  };
+
+  char buffer[32];
+  size_t length = Throw::FormatTime(localTime(2026, 3, 1, 9, 5, 7), buffer,
+                                    sizeof(buffer));
+  std::string formatted(buffer, length);
+  bool isFormatOk = formatted == "09:05:07 01 Mar 2026" &&
+                    Throw::FormatTime(0, buffer, 20) == 0;
+
+  // Day after the switch to DST is 23 hours long, the one after it is 25
+  std::vector<std::pair<time_t, std::string>> cases = {
+      {localTime(2026, 3, 30, 0, 30, 0), "2026_Mar_29"},
+      {localTime(2026, 10, 25, 23, 30, 0), "2026_Oct_24"},
+      {localTime(2026, 10, 26, 0, 30, 0), "2026_Oct_25"},
+      {localTime(2026, 3, 1, 10, 0, 0), "2026_Feb_28"},
+      {localTime(2024, 3, 1, 0, 10, 0), "2024_Feb_29"},
+      {localTime(2027, 1, 1, 0, 10, 0), "2026_Dec_31"}};
+  size_t nCorrect = 0;
+  for (auto &testCase : cases) {
+    if (Throw::Yesterday(testCase.first) == testCase.second) {
+      ++nCorrect;
+    }
+  }
+
+  if (oldZone) {
+    setenv("TZ", oldZoneValue.c_str(), 1);
+  } else {
+    unsetenv("TZ");
+  }
+  tzset();
+
+  cout << "Time: format " << formatted << " ("
+       << (isFormatOk ? "ok" : "wrong") << "), yesterday " << nCorrect
+       << " / " << cases.size() << " correct" << endl;
+}
+
+void testReplacer() {
+  Throw::Replacer replacer({{"%1", "one"}, {"%10", "ten"}, {"%2", "two"}});
+  std::string result = replacer.replace("%1, %10, %2%10%1");
+  std::string expected = "one, ten, twotenone";
+  cout << "Replacer: " << result << " ("
+       << (result == expected ? "ok" : "expected " + expected) << ")" << endl;
+}
+
+void testNameMatcher() {
+  Throw::NameMatcher matcher({"hist_*", "hist_1?", "graph[0-9]", "exact"});
+  matcher.addRegex("h.*_2[0-9]");
+
+  std::vector<size_t> indices;
+  std::string result;
+  for (std::string name : {"hist_12", "hist_25", "graph7", "exact", "none"}) {
+    matcher.match(name, indices);
+    result += name + ":";
+    for (size_t index : indices) {
+      result += " " + std::to_string(index);
+    }
+    result += "; ";
+  }
+  std::string expected = "hist_12: 0 1; hist_25: 0 4; graph7: 2; exact: 3; "
+                         "none:; ";
+  cout << "Name matcher: " << result << "("
+       << (result == expected ? "ok" : "expected " + expected) << ")" << endl;
+}
+
+void testDiscoverInputs() {
+  std::filesystem::create_directories("testDiscoverInputs/sub");
+  for (int i = 0; i < 6; ++i) {
+    std::string dirPath = i < 3 ? "testDiscoverInputs/" :
+                                  "testDiscoverInputs/sub/";
+    std::ofstream file(dirPath + "input" + std::to_string(i) + ".txt");
+    file << std::string(1000 * (i + 1), 'x');
+  }
+
+  std::vector<Throw::InputFile> inputs =
+      Throw::DiscoverInputs({"testDiscoverInputs"});
+  std::vector<std::vector<Throw::InputFile>> shards =
+      Throw::MakeShards(inputs, 2);
+  cout << "Input discovery: " << inputs.size() << " files, shard sizes:";
+  for (auto &shard : shards) {
+    uint64_t size = 0;
+    for (auto &input : shard) {
+      size += input.size;
+    }
+    cout << " " << size;
+  }
+  cout << endl;
+}
+
+void testProfile() {
+  auto measure = [](int n) {
+    for (int i = 0; i < n; ++i) {
+      THROW_PROFILE("testProfile");
+    }
+  };
+
+  // Statistics of the exited threads are kept
+  std::vector<std::thread> threadVec;
+  for (int i = 0; i < 4; ++i) {
+    threadVec.emplace_back(measure, 1000);
+  }
+  for (auto &thread : threadVec) {
+    thread.join();
+  }
+  std::vector<Throw::ProfileStats> statsVec = Throw::ProfileRegistry::collect();
+  uint64_t count = statsVec.empty() ? 0 : statsVec.front().count;
+
+  Throw::ProfileRegistry::reset();
+  measure(10);
+  statsVec = Throw::ProfileRegistry::collect();
+  uint64_t countReset = statsVec.empty() ? 0 : statsVec.front().count;
+  cout << "Profile: " << count << " / 4000 scopes, after reset " << countReset
+       << " / 10" << endl;
+  Throw::ProfileRegistry::print();
+}
+
+void testTraceRecorder() {
+  Throw::TraceRecorder::enable(1000);
+  auto record = []() {
+    for (int i = 0; i < 5000; ++i) {
+      THROW_TRACE("testTraceRecorder");
+    }
+  };
+
+  // Export while the threads record, torn spans are skipped
+  std::vector<std::thread> threadVec;
+  for (int i = 0; i < 4; ++i) {
+    threadVec.emplace_back(record);
+  }
+  Throw::TraceRecorder::write("testTraceRecorderLive.json");
+  for (auto &thread : threadVec) {
+    thread.join();
+  }
+
+  // Rings of the exited threads keep their spans until they are reused
+  Throw::TraceRecorder::write("testTraceRecorder.json");
+  Throw::TraceRecorder::disable();
+  Throw::TraceRecorder::clear();
+
+  std::ifstream file("testTraceRecorder.json");
+  std::string line;
+  int nSpans = 0;
+  while (std::getline(file, line)) {
+    if (line.find("\"ph\":\"X\"") != std::string::npos) {
+      ++nSpans;
+    }
+  }
+  cout << "Trace recorder: " << nSpans << " / 4000 spans exported" << endl;
+}
+
+void testLogger() {
+  // Buffers of the exited threads are released after they are written
+  std::vector<std::thread> threadVec;
+  for (int i = 0; i < 4; ++i) {
+    threadVec.emplace_back([i]() {
+      THROW_LOG_INFO("Test logger message from thread " + std::to_string(i));
+    });
+  }
+  for (auto &thread : threadVec) {
+    thread.join();
+  }
+  Throw::Logger::flush();
+
+  TGraph* testGraph = new TGraph(3);
+  try {
+    Throw::GetPointX(testGraph, 3);
+    cout << "Logger: out of range point not reported" << endl;
+  } catch (const Throw::Exception& error) {
+    cout << "Logger: " << error.getWhere() << " reported: " << error.what()
+         << endl;
+  }
+
+  delete testGraph;
+}
+
+void testHistCache() {
+  TFile* treeFile = new TFile("testHistCache.root", "RECREATE");
+  TTree* testTree = new TTree("testTree", "Test Tree");
+  double x = 0.;
+  testTree->Branch("x", &x);
+  TRandom3 random;
+  for (int i = 0; i < 1000; ++i) {
+    x = random.Gaus();
+    testTree->Fill();
+  }
+  testTree->Write();
+  treeFile->Close();
+  delete treeFile;
+
+  // Second histogram differs only in the name, it's loaded from the cache
+  Throw::HistCache cache("testHistCache");
+  cache.invalidateAll();
+  std::vector<std::vector<double>> contents(2);
+  for (int i = 0; i < 2; ++i) {
+    std::string name = "testHistCache" + std::to_string(i);
+    Throw::HistBooker booker("testTree", "testHistCache.root");
+    booker.setCache(&cache);
+    booker.book1D(name, "Test Histogram;x;Entries", "x", 20, -5, 5);
+    booker.run(1);
+    TH1D* hist = booker.getHist1D(name);
+    for (int j = 0; hist && j <= hist->GetNbinsX() + 1; ++j) {
+      contents.at(i).emplace_back(hist->GetBinContent(j));
+    }
+  }
+  cout << "Hist cache: " << contents.at(0).size() << " bins, round trip "
+       << (!contents.at(0).empty() && contents.at(0) == contents.at(1) ?
+           "ok" : "differs")
+       << ", cache size " << cache.getSize() << " B" << endl;
+}
+
+void testHistBooker() {
+  TFile* treeFile = new TFile("testHistBooker.root", "RECREATE");
+  TTree* testTree = new TTree("testTree", "Test Tree");
+  double x = 0.;
+  double y = 0.;
+  double w = 0.;
+  testTree->Branch("x", &x);
+  testTree->Branch("y", &y);
+  testTree->Branch("w", &w);
+  TRandom3 random;
+  for (int i = 0; i < 10000; ++i) {
+    x = random.Gaus();
+    y = random.Gaus();
+    w = random.Uniform(.5, 1.5);
+    testTree->Fill();
+  }
+  testTree->Write();
+  treeFile->Close();
+  delete treeFile;
+
+  // Expressions, cuts and weights are partly shared between the histograms
+  std::vector<Throw::HistDefinition> definitions = {
+      {"testBookerX", "X;x;Entries", "x", "", "", "", 20, -5, 5, 0, 0., 0.},
+      {"testBookerXcut", "X;x;Entries", "x", "", "y > 0", "", 20, -5, 5,
+       0, 0., 0.},
+      {"testBookerYcut", "Y;y;Entries", "y", "", "y > 0", "w", 20, -5, 5,
+       0, 0., 0.},
+      {"testBookerSum", "Sum;x + y;Entries", "x + y", "", "x > 0", "w",
+       20, -5, 5, 0, 0., 0.},
+      {"testBookerXY", "XY;x;y", "x", "y", "x > 0", "w", 10, -5, 5,
+       10, -5, 5},
+      {"testBookerXYall", "XY;x;y", "x", "y", "", "", 10, -5, 5, 10, -5, 5}};
+  Throw::HistBooker booker("testTree", "testHistBooker.root");
+  for (auto &definition : definitions) {
+    booker.book(definition);
+  }
+  booker.run(4);
+
+  treeFile = new TFile("testHistBooker.root", "READ");
+  testTree = treeFile->Get<TTree>("testTree");
+  size_t nMatching = 0;
+  for (auto &definition : definitions) {
+    std::string selection = definition.cut;
+    if (!definition.weight.empty()) {
+      selection = selection.empty() ? definition.weight :
+                  "(" + selection + ") * " + definition.weight;
+    }
+    std::string refName = definition.name + "Ref";
+    TH1* hist;
+    TH1* refHist;
+    std::string varexp;
+    if (definition.yExpression.empty()) {
+      hist = booker.getHist1D(definition.name);
+      refHist = new TH1D(refName.c_str(), "", definition.nBinsX,
+                         definition.xMin, definition.xMax);
+      varexp = definition.xExpression + ">>" + refName;
+    } else {
+      hist = booker.getHist2D(definition.name);
+      refHist = new TH2D(refName.c_str(), "", definition.nBinsX,
+                         definition.xMin, definition.xMax, definition.nBinsY,
+                         definition.yMin, definition.yMax);
+      varexp = definition.yExpression + ":" + definition.xExpression + ">>" +
+               refName;
+    }
+    testTree->Draw(varexp.c_str(), selection.c_str(), "goff");
+
+    bool isMatching = hist != nullptr;
+    for (int i = 0; isMatching && i < refHist->GetNcells(); ++i) {
+      double expected = refHist->GetBinContent(i);
+      isMatching = std::abs(hist->GetBinContent(i) - expected) <=
+                   1e-9 * (1. + std::abs(expected));
+    }
+    if (isMatching) {
+      ++nMatching;
+    }
+    delete refHist;
+  }
+  treeFile->Close();
+  delete treeFile;
+
+  cout << "Hist booker: " << nMatching << " / " << definitions.size()
+       << " histograms match TTree::Draw" << endl;
+}
+
+void testBinaryFormat() {
+  TH1D* testHist = new TH1D("testHist", "Test Histogram;label x;label y",
+                            20, -5, 8);
+  testHist->FillRandom("gaus", 1000);
+
+  Throw::BinaryWriter* writer = new Throw::BinaryWriter("testBinary.thr");
+  writer->add(testHist);
+  writer->close();
+  delete writer;
+
+  Throw::BinaryReader* reader = new Throw::BinaryReader("testBinary.thr");
+  Throw::ColumnSpan content = reader->getColumn("testHist", Throw::kBinContent);
+  cout << "Binary format: " << content.size << " bins stored, bin 10: "
+       << content.data[10] << " / " << testHist->GetBinContent(10) << endl;
+
+  Plotter1D* testPlot = new Plotter1D("testPlotBinary");
+  TH1D* readHist = reader->makeHist1D("testHist");
+  testPlot->addHist(readHist);
+  testPlot->draw();
+
+  delete testHist;
+  delete readHist;
+  delete reader;
+  delete testPlot;
+}
+
+void testProgress() {
+  TH1D* testHist = new TH1D("testHistProgress",
+                            "Test Histogram;label x;label y", 20, -5, 8);
+  TRandom3 random;
+
+  Throw::Progress progress(1000 * 1000, "Filling", "Quiet");
+  for (int i = 0; i < 1000 * 1000; ++i) {
+    testHist->Fill(random.Gaus());
+    progress.add();
+  }
+  progress.finish();
+
+  Plotter1D* testPlot = new Plotter1D("testPlotProgress");
+  testPlot->addHist(testHist);
+  testPlot->draw();
+
+  delete testHist;
+  delete testPlot;
+}
+
+void testTextReader() {
+  TH1D* testHist = new TH1D("testHistText", "Test Histogram;label x;label y",
+                            20, -5, 8);
+  testHist->FillRandom("gaus", 1000);
+  Throw::PrintHist(testHist, "testTextReader.csv", "CSV");
+
+  TH1D* readHist = new TH1D("testHistTextRead",
+                            "Test Histogram;label x;label y", 20, -5, 8);
+  Throw::TextReader reader("testTextReader.csv", "CSV");
+  reader.fill1D(readHist, "x", "y");
+  reader.run();
+
+  // Only the bins in range are printed
+  int nMismatched = 0;
+  for (int i = 1; i <= testHist->GetNbinsX(); ++i) {
+    if (readHist->GetBinContent(i) != testHist->GetBinContent(i)) {
+      cout << "Text reader: bin " << i << " differs, "
+           << readHist->GetBinContent(i) << " / "
+           << testHist->GetBinContent(i) << endl;
+      ++nMismatched;
+    }
+  }
+  cout << "Text reader: " << reader.getNrows() << " rows read, "
+       << nMismatched << " bins differ" << endl;
+
+  Plotter1D* testPlot = new Plotter1D("testPlotTextReader");
+  testPlot->addHist(readHist);
+  testPlot->draw();
+
+  delete testHist;
+  delete readHist;
+  delete testPlot;
+}
+
+void testFitBatch() {
+  std::vector<TH1*> testHists;
+  for (int i = 0; i < 8; ++i) {
+    std::string name = "testHistFit" + std::to_string(i);
+    testHists.emplace_back(new TH1D(name.c_str(),
+                                    "Test Histogram;label x;label y",
+                                    40, -5, 8));
+    testHists.back()->FillRandom("gaus", 1000 * (i + 1));
+  }
+
+  TF1* testFunc = new TF1("testFunc", "gaus", -5, 8);
+  testFunc->SetParameters(100, 0, 1);
+  std::vector<Throw::FitResult> results = Throw::FitBatch(testHists,
+                                                          testFunc, "L");
+  cout << "Fit batch: " << results.size() << " fits, chi2/ndf of the last: "
+       << results.back().chi2 << " / " << results.back().ndf << endl;
+
+  Plotter1D* testPlot = new Plotter1D("testPlotFitBatch");
+  testPlot->addHist(dynamic_cast<TH1D*>(results.back().hist));
+  testPlot->addFunc(results.back().func);
+  testPlot->draw();
+
+  for (auto &result : results) {
+    delete result.hist;
+    delete result.func;
+  }
+  delete testFunc;
+  delete testPlot;
+}
+
+void testUnbinnedFit() {
+  TRandom3 random;
+  std::vector<double> events(100 * 1000);
+  for (auto &event : events) {
+    event = random.Gaus(1., 2.);
+  }
+
+  auto gaus = [](const double* x, size_t n, const double* p, double* out) {
+    for (size_t i = 0; i < n; ++i) {
+      double t = (x[i] - p[0]) / p[1];
+      out[i] = std::exp(-.5 * t * t);
+    }
+  };
+  Throw::UnbinnedFit fit("testFuncUnbinned", gaus, -5, 8, 2);
+  fit.setData(events);
+  fit.setParName(0, "mean");
+  fit.setParName(1, "sigma");
+  fit.setParameter(0, 0.);
+  fit.setParameter(1, 1.);
+  fit.setParLimits(1, .1, 10.);
+  fit.fit();
+  cout << "Unbinned fit: mean " << fit.getParameter(0) << " +- "
+       << fit.getParError(0) << ", sigma " << fit.getParameter(1) << " +- "
+       << fit.getParError(1) << endl;
+
+  TH1D* testHist = new TH1D("testHistUnbinned",
+                            "Test Histogram;label x;label y", 52, -5, 8);
+  for (auto &event : events) {
+    testHist->Fill(event);
+  }
+  TF1* testFunc = fit.makeFunc(testHist->GetBinWidth(1));
+
+  Plotter1D* testPlot = new Plotter1D("testPlotUnbinnedFit");
+  testPlot->addHist(testHist);
+  testPlot->addFunc(testFunc);
+  testPlot->draw();
+
+  delete testHist;
+  delete testFunc;
+  delete testPlot;
+}
+
 int main() {
   testPlotter1D();
   testPlotter2D();
   testGraphSection();
+  testGraphPyramid();
+  testRasterPlotter();
+  testPrintHist();
+  testQuickOutAsync();
+  testLoadObjects();
+  testMergeFiles();
+  testSplitView();
+  testInternedString();
+  testInputParser();
+  testTime();
+  testReplacer();
+  testNameMatcher();
+  testDiscoverInputs();
+  testProfile();
+  testTraceRecorder();
+  testLogger();
+  testHistCache();
+  testHistBooker();
+  testBinaryFormat();
+  testProgress();
+  testTextReader();
+  testFitBatch();
+  testUnbinnedFit();
 
   return 0;
 }
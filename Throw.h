@@ -11,8 +11,29 @@
 
 
 // std
+#include <cstdio>
+#include <ctime>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <stdexcept>
 #include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <bitset>
+#include <regex>
+#include <future>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
 // Root
 #include <TH1.h>
 #include <TGraphAsymmErrors.h>
@@ -23,6 +44,8 @@
 #include <TLegend.h>
 #include <TLine.h>
 #include <TPaveText.h>
+#include <TCanvas.h>
+#include <TFile.h>
 
 
 namespace Throw {
@@ -41,20 +64,177 @@ namespace Throw {
   /** @} */
 
 
+  /**
+   * \class SplitView
+   * \brief Lazy range of tokens of a string split at delimiters.
+   *
+   * Tokens are views into the original string, nothing is copied. Tokens are
+   * the same as read by std::getline: empty string has no tokens, empty token
+   * after the trailing delimiter is skipped. Iterator returns the tokens by
+   * value, it's an input iterator.
+   */
+  class SplitView {
+    public:
+      class Iterator {
+        public:
+          using iterator_category = std::input_iterator_tag;
+          using value_type = std::string_view;
+          using difference_type = std::ptrdiff_t;
+          using pointer = void;
+          using reference = std::string_view;
+
+          Iterator();
+          Iterator(const SplitView*, size_t, size_t);
+          std::string_view operator*() const;
+          Iterator& operator++();
+          Iterator operator++(int);
+          bool operator==(const Iterator&) const;
+          bool operator!=(const Iterator&) const;
+        private:
+          const SplitView* view;
+          size_t tokenBegin;
+          size_t tokenEnd;
+      };
+
+      SplitView(std::string_view, char);
+      SplitView(std::string_view, std::string_view);
+
+      Iterator begin() const;
+      Iterator end() const;
+    private:
+      std::string_view str;
+      std::string delimiters;
+
+      size_t findTokenEnd(size_t) const;
+  };
+
+
+  /**
+   * \class Replacer
+   * \brief Replaces many patterns in a single pass over a string.
+   *
+   * Patterns are compiled once into an Aho-Corasick automaton, matches are
+   * chosen leftmost-longest.
+   */
+  class Replacer {
+    public:
+      Replacer(const std::map<std::string, std::string>&);
+
+      const std::string& replace(std::string_view);
+      void replace(std::string_view, std::string&) const;
+    private:
+      std::vector<int> transitionVec;
+      std::vector<int> outputVec;
+      std::vector<int> depthVec;
+      std::vector<size_t> patternLengthVec;
+      std::vector<std::string> replacementVec;
+      std::string buffer;
+  };
+
+
+  /**
+   * \class InternedString
+   * \brief Handle of a string stored in the StringPool.
+   *
+   * Equal strings share one handle, so handles are compared and hashed in
+   * constant time.
+   */
+  class InternedString {
+    public:
+      InternedString();
+      InternedString(std::string_view);
+
+      const std::string& str() const;
+      const char* c_str() const;
+      bool operator==(const InternedString&) const;
+      bool operator!=(const InternedString&) const;
+      size_t hash() const;
+    private:
+      const std::string* ptr;
+
+      friend class StringPool;
+  };
+
+
+  /**
+   * \class StringPool
+   * \brief Thread-safe process wide pool of interned strings.
+   */
+  class StringPool {
+    public:
+      static InternedString intern(std::string_view);
+  };
+
+
+  /**
+   * \class NameMatcher
+   * \brief Set of glob and regex patterns matched against names in one pass.
+   *
+   * Glob patterns are compiled into one combined automaton, literal patterns
+   * are looked up in a hash map. Matching is thread-safe and reuses buffers
+   * of the calling thread, adding patterns is not.
+   */
+  class NameMatcher {
+    public:
+      NameMatcher();
+      NameMatcher(const std::vector<std::string>&);
+
+      size_t addGlob(const std::string&);
+      size_t addRegex(const std::string&);
+      size_t getNpatterns() const;
+
+      bool matches(std::string_view) const;
+      std::vector<size_t> match(std::string_view) const;
+      void match(std::string_view, std::vector<size_t>&) const;
+    private:
+      enum StateType {kLiteral, kAnyChar, kCharClass, kStar, kAccept};
+      struct State {
+        StateType type;
+        unsigned char symbol;
+        size_t index;
+        bool anySuffix;
+      };
+
+      size_t nPatterns;
+      std::vector<State> stateVec;
+      std::vector<std::bitset<256>> charClassVec;
+      std::vector<size_t> startVec;
+      std::deque<std::string> literalStore;
+      std::unordered_map<std::string_view, std::vector<size_t>> literalMap;
+      std::vector<std::pair<size_t, std::regex>> regexVec;
+
+      void addState(size_t, std::vector<size_t>&,
+                    std::vector<bool>&) const;
+      bool matchGlobs(std::string_view, std::vector<size_t>*) const;
+  };
+
+
   /**
    * \class InputParser
    * \brief Input parser.
    *
    * Solution found
    * <a href="https://stackoverflow.com/questions/865668">here</a>.
+   *
+   * Tokens are indexed once, "--opt=value" is split into option and value and
+   * "@file" is replaced by the whitespace separated tokens from the file.
    */
   class InputParser {
     public:
       InputParser (int&, char**);
       const std::string& getCmdOption(const std::string&) const;
+      bool getCmdOption(const std::string&, int&) const;
+      bool getCmdOption(const std::string&, long long&) const;
+      bool getCmdOption(const std::string&, size_t&) const;
+      bool getCmdOption(const std::string&, double&) const;
       bool cmdOptionExists(const std::string&) const;
+      const std::vector<std::string>& getTokens() const;
     private:
       std::vector<std::string> tokens;
+      std::unordered_map<std::string, size_t> tokenIndex;
+
+      void addToken(std::string_view);
+      bool readResponseFile(const std::string&);
   };
 
 
@@ -64,6 +244,7 @@ namespace Throw {
    * @{
    */
   tm GetCurrentTime();
+  tm GetLocalTime(time_t);
   std::string MonthNumToName(int);
   std::string GetCurrentYear();
   std::string GetCurrentMonth();
@@ -74,6 +255,229 @@ namespace Throw {
   std::string Now();
   std::string Today();
   std::string Yesterday();
+  std::string Yesterday(time_t);
+  size_t FormatTime(time_t, char*, size_t);
+  size_t FormatNow(char*, size_t);
+  size_t FormatToday(char*, size_t);
+  /** @} */
+
+
+  /**
+   * \defgroup Profile Profile
+   * \brief Scoped timers and profiling report.
+   * @{
+   */
+  /**
+   * \class ProfileSite
+   * \brief Named place in the code measured by ScopedTimer.
+   *
+   * Sites with the same name share the statistics.
+   */
+  class ProfileSite {
+    public:
+      ProfileSite(const std::string&);
+
+      size_t getIndex() const;
+    private:
+      size_t index;
+  };
+
+
+  /**
+   * \class ScopedTimer
+   * \brief Measures time spent in the scope, see THROW_PROFILE.
+   */
+  class ScopedTimer {
+    public:
+      ScopedTimer(const ProfileSite&);
+      ScopedTimer(const std::string&);
+      ~ScopedTimer();
+    private:
+      size_t siteIndex;
+      std::chrono::steady_clock::time_point start;
+  };
+
+
+  /**
+   * \class ProfileStats
+   * \brief Statistics of one profile site merged over all threads.
+   *
+   * Durations are in nanoseconds, histogram bin i > 0 counts durations from
+   * 2^(i-1) ns to 2^i ns, the last bin counts also all longer durations.
+   */
+  class ProfileStats {
+    public:
+      std::string name;
+      uint64_t count;
+      uint64_t total;
+      uint64_t min;
+      uint64_t max;
+      std::vector<uint64_t> histogram;
+  };
+
+
+  /**
+   * \class ProfileRegistry
+   * \brief Registry of profile sites and per-thread statistics.
+   */
+  class ProfileRegistry {
+    public:
+      static const size_t kNbins = 32;
+
+      static size_t registerSite(const std::string&);
+      static std::vector<ProfileStats> collect();
+      static std::string report();
+      static void print();
+      static void write(const std::string&);
+      static void reset();
+  };
+
+
+  /**
+   * \class TraceSpan
+   * \brief Records the scope as a span on the timeline of the thread, see
+   * THROW_TRACE.
+   *
+   * Does nothing unless the TraceRecorder is enabled.
+   */
+  class TraceSpan {
+    public:
+      TraceSpan(const char*);
+      TraceSpan(const std::string&);
+      ~TraceSpan();
+    private:
+      const char* name;
+      std::chrono::steady_clock::time_point start;
+  };
+
+
+  /**
+   * \class TraceRecorder
+   * \brief Keeps the latest spans of every thread in ring buffers and exports
+   * them as Chrome trace-event JSON.
+   *
+   * The JSON opens in chrome://tracing or in the Perfetto UI.
+   */
+  class TraceRecorder {
+    public:
+      static void enable();
+      static void enable(size_t);
+      static void disable();
+      static bool isEnabled();
+      static void clear();
+      static bool write(const std::string&);
+  };
+  /** @} */
+
+
+  /**
+   * \class Progress
+   * \brief Progress meter of a long loop, rendered on a separate thread.
+   *
+   * Any number of threads can add to the counter. Mode "Bar" redraws one line
+   * on the standard error output, mode "Quiet" prints a timestamped line
+   * rarely, suitable for batch logs.
+   */
+  class Progress {
+    public:
+      Progress(uint64_t);
+      Progress(uint64_t, const std::string&);
+      Progress(uint64_t, const std::string&, const std::string&);
+      ~Progress();
+
+      void add();
+      void add(uint64_t);
+      uint64_t getCount();
+      void setInterval(double);
+      void finish();
+    private:
+      // Counter has its own cache line, padding keeps other members off it
+      alignas(64) std::atomic<uint64_t> count;
+      char countPadding[64 - sizeof(std::atomic<uint64_t>)];
+      uint64_t total;
+      std::string label;
+      bool quiet;
+      std::chrono::duration<double> interval;
+      std::chrono::steady_clock::time_point start;
+
+      bool finished;
+      std::mutex renderMutex;
+      std::condition_variable renderChanged;
+      std::thread renderThread;
+
+      void run();
+      void render(bool);
+  };
+
+
+  /**
+   * \defgroup Log Log
+   * \brief Asynchronous logger, see THROW_LOG, and errors thrown by the
+   * library.
+   * @{
+   */
+  enum LogLevel {
+    kLogDebug = 0,
+    kLogInfo,
+    kLogWarning,
+    kLogError
+  };
+
+
+  /**
+   * \class LogSite
+   * \brief Place in the code which logs, keeps its rate limit.
+   */
+  class LogSite {
+    public:
+      LogSite();
+
+      bool allow();
+      uint64_t takeSuppressed();
+    private:
+      std::atomic<int64_t> window;
+      std::atomic<uint64_t> nInWindow;
+      std::atomic<uint64_t> nSuppressed;
+  };
+
+
+  /**
+   * \class Logger
+   * \brief Collects messages in per-thread buffers and writes them to the
+   * standard error output on a background thread.
+   *
+   * Messages which don't fit into the buffer are dropped and counted.
+   */
+  class Logger {
+    public:
+      static void setLevel(LogLevel);
+      static LogLevel getLevel();
+      static bool isEnabled(LogLevel);
+      static void setRateLimit(uint64_t);
+      static uint64_t getRateLimit();
+
+      static void log(LogLevel, LogSite&, const std::string&);
+      static void flush();
+  };
+
+
+  /**
+   * \class Exception
+   * \brief Error thrown by the library.
+   *
+   * what() returns the same text as the library prints,
+   * "ERROR: <where> -- <message>!".
+   */
+  class Exception : public std::runtime_error {
+    public:
+      Exception(const std::string&, const std::string&);
+
+      const std::string& getWhere() const;
+      const std::string& getMessage() const;
+    private:
+      std::string where;
+      std::string message;
+  };
   /** @} */
 
 
@@ -130,32 +534,568 @@ namespace Throw {
   /** @} */
 
 
+  /**
+   * \class GraphPyramid
+   * \brief Multi-resolution minimum/maximum/mean summary of a long graph.
+   *
+   * Allows to draw any x-window of the graph in time proportional to the
+   * number of pixels instead of the number of points.
+   */
+  class GraphPyramid {
+    public:
+      GraphPyramid(TGraph*);
+      GraphPyramid(const std::string&, const std::string&);
+      ~GraphPyramid();
+
+      std::string getName();
+      size_t getNlevels();
+      TGraphAsymmErrors* getLevel(size_t);
+      size_t pickLevel(double, double, int);
+      TGraphAsymmErrors* makeWindow(double, double, int);
+
+      void write(const std::string&);
+    private:
+      std::string name;
+      std::vector<TGraphAsymmErrors*> levelVec;
+  };
+
+
+  /**
+   * \class FitResult
+   * \brief Result of one fit of FitBatch.
+   *
+   * The fitted function is owned by the caller.
+   */
+  class FitResult {
+    public:
+      TH1* hist;
+      TF1* func;
+      int status;
+      double chi2;
+      int ndf;
+  };
+
+
+  /**
+   * \defgroup Fit Fit
+   * \brief Fitting related functions.
+   *
+   * FitBatch with more than one thread enables the thread safety of ROOT for
+   * the rest of the program, the default minimizer isn't changed.
+   * @{
+   */
+  std::vector<FitResult> FitBatch(const std::vector<TH1*>&, TF1*);
+  std::vector<FitResult> FitBatch(const std::vector<TH1*>&, TF1*,
+                                  const std::string&);
+  std::vector<FitResult> FitBatch(const std::vector<TH1*>&, TF1*,
+                                  const std::string&, size_t);
+  /** @} */
+
+
+  /**
+   * \class UnbinnedFit
+   * \brief Multithreaded unbinned maximum likelihood fit minimized by
+   * Minuit2.
+   *
+   * The PDF is evaluated on batches of events: it gets the positions, their
+   * number, the parameters and fills the values. A plain loop over the batch
+   * lets the compiler vectorize it. The PDF doesn't have to be normalized.
+   */
+  class UnbinnedFit {
+    public:
+      UnbinnedFit(const std::string&,
+                  const std::function<void(const double*, size_t,
+                                           const double*, double*)>&,
+                  double, double, int);
+
+      void setData(const std::vector<double>&);
+      void setData(const double*, size_t);
+      void setParameter(int, double);
+      void setParName(int, const std::string&);
+      void setParLimits(int, double, double);
+      void fixParameter(int, double);
+
+      int fit();
+      int fit(size_t);
+      size_t getNevents();
+      double getParameter(int);
+      double getParError(int);
+      double getMinNll();
+      double getNll(const std::vector<double>&);
+      TF1* makeFunc();
+      TF1* makeFunc(double);
+    private:
+      std::string name;
+      std::function<void(const double*, size_t, const double*, double*)> pdf;
+      double xMin;
+      double xMax;
+      std::vector<double> eventVec;
+      std::vector<std::string> parNameVec;
+      std::vector<double> parValueVec;
+      std::vector<double> parErrorVec;
+      std::vector<double> parLowVec;
+      std::vector<double> parHighVec;
+      std::vector<char> parFixedVec;
+      double minNll;
+
+      void checkParIndex(int);
+      double sumLogPdf(const double*, size_t, size_t);
+      double computeNll(const std::vector<double>&,
+                        const std::function<double(const double*)>&);
+  };
+
+
+  /**
+   * \class InputFile
+   * \brief Discovered input file with its size and modification time.
+   */
+  class InputFile {
+    public:
+      std::string path;
+      uint64_t size;
+      int64_t mtime;
+  };
+
+
   /**
    * \defgroup IO Input/Output
    * \brief I/O related functions.
    * @{
    */
   bool FileExists(const std::string&);
-  void PrintHist(TH1D*, const std::string&);
+  void PrintHist(TH1*, const std::string&);
+  void PrintHist(TH1*, const std::string&, const std::string&);
+  void PrintHist(TH2*, const std::string&);
+  void PrintHist(TH2*, const std::string&, const std::string&);
+  void PrintGraph(TGraph*, const std::string&);
+  void PrintGraph(TGraph*, const std::string&, const std::string&);
+  void PrintGraph(TGraph2D*, const std::string&);
+  void PrintGraph(TGraph2D*, const std::string&, const std::string&);
   void QuickOut(TObject*);
   void QuickOut(TObject*, const std::string&);
   void QuickOut(TObject*, const std::string&, const std::string&);
+  void QuickOut(TObject*, const std::string&, const std::string&,
+                const std::string&);
+  int GetCompressionSettings(const std::string&);
+  std::map<std::string, std::vector<TObject*>> LoadObjects(
+      const std::vector<std::string>&, const std::vector<std::string>&);
+  std::map<std::string, std::vector<TObject*>> LoadObjects(
+      const std::vector<std::string>&, const std::vector<std::string>&,
+      size_t);
+  std::map<std::string, std::vector<TObject*>> LoadObjects(
+      const std::vector<std::string>&, const NameMatcher&);
+  std::map<std::string, std::vector<TObject*>> LoadObjects(
+      const std::vector<std::string>&, const NameMatcher&, size_t);
+  bool MergeFiles(const std::vector<std::string>&, const std::string&);
+  bool MergeFiles(const std::vector<std::string>&, const std::string&,
+                  size_t);
+  std::future<bool> QuickOutAsync(TObject*);
+  std::future<bool> QuickOutAsync(TObject*, const std::string&);
+  std::future<bool> QuickOutAsync(TObject*, const std::string&,
+                                  const std::string&);
+  void ShutdownQuickOutAsync();
+  std::vector<InputFile> DiscoverInputs(const std::vector<std::string>&);
+  std::vector<InputFile> DiscoverInputs(const std::vector<std::string>&,
+                                        size_t);
+  void ClearInputCache();
+  std::vector<std::vector<InputFile>> MakeShards(
+      const std::vector<InputFile>&, size_t);
+  std::vector<InputFile> MakeShard(const std::vector<InputFile>&, size_t,
+                                   size_t);
+  /** @} */
+
+
+  /**
+   * \class QuickOutSession
+   * \brief Writes many objects while keeping one open root file per path.
+   *
+   * Files are flushed and closed once, when the session is closed. With a
+   * limit on open files the least recently used file is closed first and
+   * reopened for update when it's written again.
+   */
+  class QuickOutSession {
+    public:
+      QuickOutSession();
+      QuickOutSession(const std::string&);
+      ~QuickOutSession();
+
+      void setMaxOpenFiles(size_t);
+      bool write(TObject*, const std::string&);
+      bool write(TObject*, const std::string&, const std::string&);
+      void flush(const std::string&);
+      void flush();
+      void close();
+    private:
+      int compression;
+      size_t maxOpenFiles;
+      uint64_t useCount;
+      std::unordered_map<std::string, TFile*> fileMap;
+      std::unordered_map<std::string, uint64_t> lastUseMap;
+      std::unordered_set<std::string> createdSet;
+      std::unordered_set<std::string> dirSet;
+
+      TFile* getFile(const std::string&);
+      void closeFile(const std::string&);
+  };
+
+
+  /**
+   * \class AsyncWriter
+   * \brief Writes objects to root files on a dedicated I/O thread.
+   *
+   * Objects queued for the same file and name before the thread gets to them
+   * are coalesced, only the last one is written. Number of objects held by the
+   * writer is bounded, producers wait when the limit is reached. Tasks running
+   * on the I/O thread may queue more jobs without waiting. At most 16 files
+   * are kept open, see QuickOutSession::setMaxOpenFiles.
+   */
+  class AsyncWriter {
+    public:
+      AsyncWriter();
+      AsyncWriter(size_t);
+      AsyncWriter(size_t, const std::string&);
+      ~AsyncWriter();
+
+      std::future<bool> write(TObject*, const std::string&);
+      std::future<bool> write(TObject*, const std::string&,
+                              const std::string&);
+      std::future<bool> writeSnapshot(TObject*, const std::string&,
+                                      const std::string&);
+      std::future<bool> submit(const std::function<bool()>&);
+      void flush();
+      void shutdown();
+    private:
+      struct Job {
+        std::unique_ptr<TObject> object;
+        std::string filePath;
+        std::string name;
+        std::function<bool()> task;
+        std::promise<bool> promise;
+      };
+
+      std::string compressionProfile;
+      size_t maxPending;
+      size_t nPending;
+      bool stopping;
+      std::deque<Job> jobQueue;
+      std::mutex queueMutex;
+      std::condition_variable queueChanged;
+      std::thread ioThread;
+
+      std::future<bool> enqueue(Job&);
+      void run();
+  };
+
+
+  /**
+   * \class BufferedWriter
+   * \brief Output file with a large user space buffer.
+   *
+   * Numbers are formatted with std::to_chars in the shortest representation
+   * which reads back to the same value.
+   */
+  class BufferedWriter {
+    public:
+      BufferedWriter(const std::string&);
+      BufferedWriter(const std::string&, size_t);
+      ~BufferedWriter();
+      BufferedWriter(const BufferedWriter&) = delete;
+      BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+      bool isGood();
+      bool flush();
+      bool close();
+
+      void write(const std::string&);
+      void write(const char*, size_t);
+      void write(char);
+      void write(double);
+      void write(long long);
+    private:
+      FILE* file;
+      bool failed;
+      std::vector<char> buffer;
+      size_t used;
+  };
+
+
+  /**
+   * \defgroup Binary Binary format
+   * \brief Columnar binary format (.thr) for histograms and graphs.
+   *
+   * File starts with 64 bytes long header (magic "THRWBIN", format version,
+   * number of objects and offset of the object index). Columns of doubles
+   * follow, each aligned to 64 bytes, object index is stored at the end of
+   * the file. Numbers are stored in the native byte order.
+   * @{
+   */
+  enum BinaryObject {
+    kBinaryTH1 = 1,
+    kBinaryTH2 = 2,
+    kBinaryGraph = 3,
+    kBinaryGraph2D = 4
+  };
+
+  enum BinaryColumn {
+    kBinXedges = 0,
+    kBinYedges,
+    kBinContent,
+    kBinError,
+    kPointX,
+    kPointY,
+    kPointZ,
+    kPointEX,
+    kPointEY,
+    kPointEZ,
+    kPointEXlow,
+    kPointEXhigh,
+    kPointEYlow,
+    kPointEYhigh,
+    kNbinaryColumns
+  };
   /** @} */
 
 
+  /**
+   * \class ColumnSpan
+   * \brief Read-only view of a column of numbers.
+   */
+  class ColumnSpan {
+    public:
+      const double* data;
+      size_t size;
+  };
+
+
+  /**
+   * \class BinaryWriter
+   * \brief Writer of the columnar binary format.
+   */
+  class BinaryWriter {
+    public:
+      BinaryWriter(const std::string&);
+      ~BinaryWriter();
+      BinaryWriter(const BinaryWriter&) = delete;
+      BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+      void add(TH1*);
+      void add(TH2*);
+      void add(TGraph*);
+      void add(TGraph2D*);
+
+      bool isGood();
+      bool close();
+    private:
+      FILE* file;
+      bool failed;
+      uint64_t offset;
+      uint32_t nObjects;
+      std::vector<char> index;
+      std::unordered_set<std::string> nameSet;
+
+      void addObject(int, const std::string&, const std::string&,
+                     const std::vector<std::pair<int, std::vector<double>>>&);
+      void writeRaw(const void*, size_t);
+  };
+
+
+  /**
+   * \class BinaryReader
+   * \brief Memory mapped reader of the columnar binary format.
+   *
+   * Columns are exposed directly from the mapped file, so only the pages which
+   * are touched are loaded from the disk.
+   */
+  class BinaryReader {
+    public:
+      BinaryReader(const std::string&);
+      ~BinaryReader();
+      BinaryReader(const BinaryReader&) = delete;
+      BinaryReader& operator=(const BinaryReader&) = delete;
+
+      std::vector<std::string> getNames();
+      bool hasObject(const std::string&);
+      int getType(const std::string&);
+      std::string getTitle(const std::string&);
+      bool hasColumn(const std::string&, int);
+      ColumnSpan getColumn(const std::string&, int);
+
+      TH1D* makeHist1D(const std::string&);
+      TH2D* makeHist2D(const std::string&);
+      TGraphAsymmErrors* makeGraph(const std::string&);
+      TGraph2D* makeGraph2D(const std::string&);
+    private:
+      struct Entry {
+        int type;
+        std::string title;
+        ColumnSpan columns[kNbinaryColumns];
+      };
+
+      void* mapping;
+      size_t mappingSize;
+      std::vector<std::string> nameVec;
+      std::unordered_map<std::string, Entry> entryMap;
+
+      const Entry& getEntry(const std::string&);
+  };
+
+
+  /**
+   * \class TextReader
+   * \brief Memory mapped reader of numeric text tables filling histograms.
+   *
+   * The file is split into newline aligned chunks parsed in parallel. Every
+   * thread fills its own copy of the histograms, memory use doesn't depend on
+   * the size of the file. Reads tables written by PrintHist and PrintGraph.
+   */
+  class TextReader {
+    public:
+      TextReader(const std::string&);
+      TextReader(const std::string&, const std::string&);
+      ~TextReader();
+      TextReader(const TextReader&) = delete;
+      TextReader& operator=(const TextReader&) = delete;
+
+      std::vector<std::string> getColumnNames();
+      void fill1D(TH1*, const std::string&);
+      void fill1D(TH1*, const std::string&, const std::string&);
+      void fill2D(TH2*, const std::string&, const std::string&);
+      void fill2D(TH2*, const std::string&, const std::string&,
+                  const std::string&);
+      void run();
+      void run(size_t);
+      uint64_t getNrows();
+      uint64_t getNbadRows();
+    private:
+      struct Fill {
+        TH1* hist;
+        bool is2D;
+        size_t xColumn;
+        size_t yColumn;
+        size_t weightColumn;
+      };
+
+      void* mapping;
+      size_t mappingSize;
+      size_t dataBegin;
+      char separator;
+      std::vector<std::string> columnNameVec;
+      std::vector<Fill> fillVec;
+      uint64_t nRows;
+      uint64_t nBadRows;
+
+      size_t getColumnIndex(const std::string&);
+  };
+
+
+  /**
+   * \class HistDefinition
+   * \brief Declarative definition of a histogram booked by HistBooker.
+   *
+   * Expressions, cut and weight are RDataFrame expressions. Empty y expression
+   * makes one-dimensional histogram, empty cut selects all entries and empty
+   * weight means unit weights.
+   */
+  class HistDefinition {
+    public:
+      std::string name;
+      std::string title;
+      std::string xExpression;
+      std::string yExpression;
+      std::string cut;
+      std::string weight;
+      int nBinsX;
+      double xMin;
+      double xMax;
+      int nBinsY;
+      double yMin;
+      double yMax;
+  };
+
+
+  /**
+   * \class HistCache
+   * \brief On-disk cache of filled histograms.
+   *
+   * Histograms are keyed by the identity of the input files (path, size and
+   * modification time), the tree and the histogram definition without its
+   * name and title. Least recently used entries are removed when the cache
+   * grows over its size limit.
+   */
+  class HistCache {
+    public:
+      HistCache(const std::string&);
+      HistCache(const std::string&, uint64_t);
+
+      std::string makeKey(const std::string&, const std::vector<std::string>&,
+                          const HistDefinition&);
+      TH1* load(const std::string&);
+      bool store(const std::string&, TH1*);
+      void invalidate(const std::string&);
+      void invalidateAll();
+      uint64_t getSize();
+      void prune();
+    private:
+      std::string cacheDir;
+      uint64_t maxSize;
+      uint64_t size;
+
+      std::string getFilePath(const std::string&);
+  };
+
+
+  /**
+   * \class HistBooker
+   * \brief Fills many histograms from a tree in a single multithreaded
+   * RDataFrame event loop.
+   *
+   * Histograms are owned by the booker. With a HistCache only histograms
+   * missing in the cache are filled. Implicit multithreading of ROOT is
+   * changed only for the event loop of run(), the setting of the caller is
+   * restored when it returns.
+   */
+  class HistBooker {
+    public:
+      HistBooker(const std::string&, const std::string&);
+      HistBooker(const std::string&, const std::vector<std::string>&);
+      ~HistBooker();
+
+      void book(const HistDefinition&);
+      void book1D(const std::string&, const std::string&, const std::string&,
+                  int, double, double);
+      void book2D(const std::string&, const std::string&, const std::string&,
+                  const std::string&, int, double, double, int, double, double);
+      void run();
+      void run(size_t);
+
+      TH1D* getHist1D(const std::string&);
+      TH2D* getHist2D(const std::string&);
+      void setCache(HistCache*);
+    private:
+      HistCache* cache;
+      std::string treeName;
+      std::vector<std::string> filePathVec;
+      std::vector<HistDefinition> definitionVec;
+      std::map<std::string, TH1D*> hist1DMap;
+      std::map<std::string, TH2D*> hist2DMap;
+
+      void clear();
+  };
+
+
   /**
    * \class Plotter
    * \brief Base of the plotting classes.
    */
   class Plotter {
     private:
-      std::vector<std::string> histDrawParamsVec;
-      std::vector<std::string> graphDrawParamsVec;
-      std::vector<std::string> funcDrawParamsVec;
+      std::vector<InternedString> histDrawParamsVec;
+      std::vector<InternedString> graphDrawParamsVec;
+      std::vector<InternedString> funcDrawParamsVec;
 
-      std::string xLabel;
-      std::string yLabel;
-      std::vector<std::string> noteVec;
+      InternedString xLabel;
+      InternedString yLabel;
+      std::vector<InternedString> noteVec;
 
       std::vector<int> colorVec;
       std::vector<int> markerVec;
@@ -173,6 +1113,12 @@ namespace Throw {
 
       std::string outFilePath;
 
+      bool rasterize;
+      int rasterDpi;
+
+    protected:
+      void rasterizeDataLayer(TCanvas*);
+
     public:
       std::vector<TLine*> lineVec;
       std::vector<TPaveText*> labelVec;
@@ -180,9 +1126,9 @@ namespace Throw {
       void addHistDrawParam(const std::string&);
       void addGraphDrawParam(const std::string&);
       void addFuncDrawParam(const std::string&);
-      std::string getHistDrawParam(int);
-      std::string getGraphDrawParam(int);
-      std::string getFuncDrawParam(int);
+      const std::string& getHistDrawParam(int);
+      const std::string& getGraphDrawParam(int);
+      const std::string& getFuncDrawParam(int);
       void setHistDrawParam(int, const std::string&);
       void setGraphDrawParam(int, const std::string&);
       void setFuncDrawParam(int, const std::string&);
@@ -227,8 +1173,8 @@ namespace Throw {
 
       void setXlabel(const std::string&);
       void setYlabel(const std::string&);
-      std::string getXlabel();
-      std::string getYlabel();
+      const std::string& getXlabel();
+      const std::string& getYlabel();
 
       std::string getNote(int);
       void setNote(int, const std::string&);
@@ -242,8 +1188,13 @@ namespace Throw {
       int pickColor(int);
       int pickMarker(int);
 
-      std::string getOutFilePath();
+      const std::string& getOutFilePath();
       void setOutFilePath(const std::string&);
+
+      void setRasterize(bool);
+      bool getRasterize();
+      void setRasterDpi(int);
+      int getRasterDpi();
   };
 
   /**
@@ -255,6 +1206,7 @@ namespace Throw {
       std::vector<TH1D*> histVec;
       std::vector<TGraphAsymmErrors*> graphVec;
       std::vector<TF1*> funcVec;
+      std::vector<GraphPyramid*> pyramidVec;
 
       int nObj();
 
@@ -271,6 +1223,7 @@ namespace Throw {
       void addGraph(TGraph*);
       void addGraph(TGraphAsymmErrors*);
       void addFunc(TF1*);
+      void addPyramid(GraphPyramid*);
       TH1D* getHist(int);
       TGraphAsymmErrors* getGraph(int);
       TF1* getFunc(int);
@@ -310,4 +1263,67 @@ namespace Throw {
 }
 
 
+namespace std {
+  /**
+   * \brief Hash of the InternedString handle.
+   */
+  template<>
+  struct hash<Throw::InternedString> {
+    size_t operator()(const Throw::InternedString& str) const {
+      return str.hash();
+    }
+  };
+}
+
+
+#define THROW_CONCAT_IMPL(first, second) first##second
+#define THROW_CONCAT(first, second) THROW_CONCAT_IMPL(first, second)
+/**
+ * \ingroup Profile
+ * \brief Measure time spent in the rest of the enclosing scope.
+ *
+ * The site is registered only once, at the first pass.
+ */
+#define THROW_PROFILE(name) \
+  static const Throw::ProfileSite THROW_CONCAT(throwProfileSite, __LINE__)( \
+      name); \
+  Throw::ScopedTimer THROW_CONCAT(throwScopedTimer, __LINE__)( \
+      THROW_CONCAT(throwProfileSite, __LINE__))
+
+/**
+ * \ingroup Profile
+ * \brief Record the rest of the enclosing scope as a trace span.
+ */
+#define THROW_TRACE(name) \
+  Throw::TraceSpan THROW_CONCAT(throwTraceSpan, __LINE__)(name)
+
+
+/**
+ * \ingroup Log
+ * \brief Messages below this level are removed at compile time.
+ */
+#ifndef THROW_LOG_MIN_LEVEL
+#define THROW_LOG_MIN_LEVEL 0
+#endif
+
+/**
+ * \ingroup Log
+ * \brief Log message, which is built only if it passes the level and the rate
+ * limit of the call site.
+ */
+#define THROW_LOG(level, message) \
+  do { \
+    if ((level) >= THROW_LOG_MIN_LEVEL && \
+        Throw::Logger::isEnabled(level)) { \
+      static Throw::LogSite throwLogSite; \
+      if (throwLogSite.allow()) { \
+        Throw::Logger::log(level, throwLogSite, message); \
+      } \
+    } \
+  } while (0)
+#define THROW_LOG_DEBUG(message) THROW_LOG(Throw::kLogDebug, message)
+#define THROW_LOG_INFO(message) THROW_LOG(Throw::kLogInfo, message)
+#define THROW_LOG_WARNING(message) THROW_LOG(Throw::kLogWarning, message)
+#define THROW_LOG_ERROR(message) THROW_LOG(Throw::kLogError, message)
+
 #endif /* THROW_H */
@@ -0,0 +1,292 @@
+/**
+ * \file ThrowAsyncWriter.cxx
+ * \brief Implementation of AsyncWriter.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+#include <thread>
+// Root
+#include <TROOT.h>
+#include <TH1.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Start the I/O thread, at most 64 objects are held at once.
+ */
+Throw::AsyncWriter::AsyncWriter() : AsyncWriter(64) {
+}
+
+/**
+ * \brief Start the I/O thread writing with the ROOT default compression.
+ *
+ * \param maxObjects maximum number of objects held by the writer, including
+ * the ones being written.
+ */
+Throw::AsyncWriter::AsyncWriter(size_t maxObjects) :
+    AsyncWriter(maxObjects, "default") {
+}
+
+/**
+ * \brief Start the I/O thread.
+ *
+ * \param maxObjects maximum number of objects held by the writer, including
+ * the ones being written.
+ * \param profile compression profile, see Throw::GetCompressionSettings.
+ */
+Throw::AsyncWriter::AsyncWriter(size_t maxObjects,
+                                const std::string& profile) {
+  ROOT::EnableThreadSafety();
+
+  // Validate the profile before the I/O thread starts
+  compressionProfile = profile;
+  GetCompressionSettings(compressionProfile);
+  maxPending = maxObjects < 1 ? 1 : maxObjects;
+  nPending = 0;
+  stopping = false;
+  ioThread = std::thread(&AsyncWriter::run, this);
+}
+
+/**
+ * \brief Write all queued objects, close the files and stop the I/O thread.
+ */
+Throw::AsyncWriter::~AsyncWriter() {
+  shutdown();
+}
+
+/**
+ * \brief Write all queued objects, close the files and stop the I/O thread.
+ *
+ * Jobs queued afterwards are rejected, calling it again does nothing. It
+ * can't be called from a task running on the I/O thread.
+ */
+void Throw::AsyncWriter::shutdown() {
+  if (std::this_thread::get_id() == ioThread.get_id()) {
+    throw Exception("Throw::AsyncWriter::shutdown",
+                    "Called from the I/O thread");
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    stopping = true;
+  }
+  queueChanged.notify_all();
+
+  if (ioThread.joinable()) {
+    ioThread.join();
+  }
+}
+
+/**
+ * \brief Queue the job, wait while the writer is full.
+ *
+ * Jobs queued by tasks running on the I/O thread don't wait, the thread
+ * would wait for itself.
+ */
+std::future<bool> Throw::AsyncWriter::enqueue(Job& job) {
+  std::future<bool> result = job.promise.get_future();
+  bool ioCaller = std::this_thread::get_id() == ioThread.get_id();
+
+  std::unique_lock<std::mutex> lock(queueMutex);
+  if (stopping && !ioCaller) {
+    throw Exception("Throw::AsyncWriter", "Writer is shut down");
+  }
+  if (!ioCaller) {
+    queueChanged.wait(lock, [this] { return nPending < maxPending; });
+  }
+  jobQueue.emplace_back(std::move(job));
+  ++nPending;
+  lock.unlock();
+  queueChanged.notify_all();
+
+  return result;
+}
+
+/**
+ * \brief Queue object to be written to a root file under its own name.
+ *
+ * \param object object to be written, the writer takes ownership of it.
+ * \param filePath root file path.
+ */
+std::future<bool> Throw::AsyncWriter::write(TObject* object,
+                                            const std::string& filePath) {
+
+  return write(object, filePath, "");
+}
+
+/**
+ * \brief Queue object to be written to a root file.
+ *
+ * Files are recreated when they are used for the first time by the writer.
+ * The future holds whether the object was written, it becomes ready after the
+ * file is flushed.
+ *
+ * \param object object to be written, the writer takes ownership of it.
+ * \param filePath root file path.
+ * \param name object name, name of the object is used if empty.
+ */
+std::future<bool> Throw::AsyncWriter::write(TObject* object,
+                                            const std::string& filePath,
+                                            const std::string& name) {
+  if (!object) {
+    throw Exception("Throw::AsyncWriter::write", "Null TObject* provided");
+  }
+
+  if (TH1* hist = dynamic_cast<TH1*>(object)) {
+    hist->SetDirectory(nullptr);
+  }
+
+  Job job;
+  job.object.reset(object);
+  job.filePath = filePath;
+  job.name = name.empty() ? std::string(object->GetName()) : name;
+
+  return enqueue(job);
+}
+
+/**
+ * \brief Queue copy of the object to be written to a root file.
+ *
+ * The object stays with the caller and can be modified right away.
+ *
+ * \param object object to be written.
+ * \param filePath root file path.
+ * \param name object name, name of the object is used if empty.
+ */
+std::future<bool> Throw::AsyncWriter::writeSnapshot(
+    TObject* object,
+    const std::string& filePath,
+    const std::string& name) {
+  if (!object) {
+    throw Exception("Throw::AsyncWriter::writeSnapshot",
+                    "Null TObject* provided");
+  }
+
+  std::string objectName = name.empty() ? object->GetName() : name;
+
+  return write(object->Clone(), filePath, objectName);
+}
+
+/**
+ * \brief Queue arbitrary I/O task, e.g. one of the text exporters.
+ *
+ * Tasks are run on the I/O thread in the order they were queued.
+ *
+ * \param task function returning whether it succeeded.
+ */
+std::future<bool> Throw::AsyncWriter::submit(
+    const std::function<bool()>& task) {
+  Job job;
+  job.task = task;
+
+  return enqueue(job);
+}
+
+/**
+ * \brief Wait until all queued jobs are done.
+ *
+ * It can't be called from a task running on the I/O thread.
+ */
+void Throw::AsyncWriter::flush() {
+  if (std::this_thread::get_id() == ioThread.get_id()) {
+    throw Exception("Throw::AsyncWriter::flush", "Called from the I/O thread");
+  }
+
+  std::unique_lock<std::mutex> lock(queueMutex);
+  queueChanged.wait(lock, [this] { return nPending == 0; });
+}
+
+/**
+ * \brief Body of the I/O thread.
+ *
+ * Takes all queued jobs at once, writes them with one session and flushes the
+ * touched files before the futures are fulfilled. At most 16 files are kept
+ * open, the least recently used one is closed first.
+ */
+void Throw::AsyncWriter::run() {
+  QuickOutSession session(compressionProfile);
+  session.setMaxOpenFiles(16);
+
+  while (true) {
+    std::deque<Job> batch;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      queueChanged.wait(lock, [this] {
+        return stopping || !jobQueue.empty();
+      });
+      if (jobQueue.empty()) {
+        break;
+      }
+      batch.swap(jobQueue);
+    }
+
+    std::map<std::pair<std::string, std::string>, size_t> lastWrite;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (batch[i].object) {
+        lastWrite[std::make_pair(batch[i].filePath, batch[i].name)] = i;
+      }
+    }
+
+    std::vector<bool> results(batch.size(), false);
+    std::vector<std::exception_ptr> errors(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+      Job& job = batch[i];
+      try {
+        if (job.task) {
+          results[i] = job.task();
+        } else if (lastWrite[std::make_pair(job.filePath, job.name)] == i) {
+          results[i] = session.write(job.object.get(), job.filePath, job.name);
+        }
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+
+    std::set<std::string> touchedSet;
+    for (auto &write : lastWrite) {
+      touchedSet.emplace(write.first.first);
+    }
+
+    try {
+      for (auto &filePath : touchedSet) {
+        session.flush(filePath);
+      }
+    } catch (...) {
+      for (auto &error : errors) {
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+      Job& job = batch[i];
+      size_t index = i;
+      if (job.object) {
+        index = lastWrite[std::make_pair(job.filePath, job.name)];
+      }
+
+      if (errors[index]) {
+        job.promise.set_exception(errors[index]);
+      } else {
+        job.promise.set_value(results[index]);
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      nPending -= batch.size();
+    }
+    batch.clear();
+    queueChanged.notify_all();
+  }
+
+  session.close();
+}
@@ -0,0 +1,374 @@
+/**
+ * \file ThrowBinaryReader.cxx
+ * \brief Implementation of BinaryReader.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <cstring>
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+// Root
+#include <TH1.h>
+#include <TH2.h>
+#include <TGraphAsymmErrors.h>
+#include <TGraph2DErrors.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Test whether the column is present and has the size.
+ */
+static bool HasSize(const Throw::ColumnSpan& column, size_t size) {
+
+  return column.data && column.size == size;
+}
+
+/**
+ * \brief Test whether the column is absent or has the size.
+ */
+static bool IsAbsentOrHasSize(const Throw::ColumnSpan& column, size_t size) {
+
+  return !column.data || column.size == size;
+}
+
+/**
+ * \brief Map the file into memory and read the object index.
+ *
+ * \param filePath location of the file.
+ */
+Throw::BinaryReader::BinaryReader(const std::string& filePath) {
+  mapping = nullptr;
+  mappingSize = 0;
+
+  int fd = open(filePath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw Exception("Throw::BinaryReader", "Can't open input file");
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size < 64) {
+    ::close(fd);
+    throw Exception("Throw::BinaryReader", "Input file is too short");
+  }
+  mappingSize = fileStat.st_size;
+
+  mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    mapping = nullptr;
+    throw Exception("Throw::BinaryReader", "Can't map input file");
+  }
+
+  const char* base = static_cast<const char*>(mapping);
+  uint32_t version = 0;
+  uint32_t nObjects = 0;
+  uint64_t indexOffset = 0;
+  memcpy(&version, base + 8, sizeof(version));
+  memcpy(&nObjects, base + 12, sizeof(nObjects));
+  memcpy(&indexOffset, base + 16, sizeof(indexOffset));
+  if (memcmp(base, "THRWBIN", 8) != 0 || version != 1) {
+    munmap(mapping, mappingSize);
+    throw Exception("Throw::BinaryReader", "Unknown file format");
+  }
+
+  size_t pos = indexOffset;
+  auto read = [&](void* data, size_t length) {
+    if (pos > mappingSize || length > mappingSize - pos) {
+      munmap(mapping, mappingSize);
+      throw Exception("Throw::BinaryReader", "Corrupted object index");
+    }
+    memcpy(data, base + pos, length);
+    pos += (length + 7) / 8 * 8;
+  };
+
+  for (uint32_t i = 0; i < nObjects; ++i) {
+    uint32_t entryHeader[4];
+    read(entryHeader, sizeof(entryHeader));
+
+    std::string name(entryHeader[1], '\0');
+    read(&name[0], name.size());
+    Entry entry;
+    entry.type = entryHeader[0];
+    entry.title.resize(entryHeader[2]);
+    read(&entry.title[0], entry.title.size());
+    for (int j = 0; j < kNbinaryColumns; ++j) {
+      entry.columns[j].data = nullptr;
+      entry.columns[j].size = 0;
+    }
+
+    for (uint32_t j = 0; j < entryHeader[3]; ++j) {
+      uint64_t descriptor[3];
+      read(descriptor, sizeof(descriptor));
+      // Columns are aligned, the size is checked without overflow
+      if (descriptor[0] >= kNbinaryColumns || descriptor[1] > mappingSize ||
+          descriptor[1] % sizeof(double) != 0 ||
+          descriptor[2] > (mappingSize - descriptor[1]) / sizeof(double)) {
+        munmap(mapping, mappingSize);
+        throw Exception("Throw::BinaryReader", "Corrupted column descriptor");
+      }
+      entry.columns[descriptor[0]].data =
+          reinterpret_cast<const double*>(base + descriptor[1]);
+      entry.columns[descriptor[0]].size = descriptor[2];
+    }
+
+    if (entryMap.count(name)) {
+      munmap(mapping, mappingSize);
+      throw Exception("Throw::BinaryReader", "Duplicate object name");
+    }
+    nameVec.emplace_back(name);
+    entryMap[name] = entry;
+  }
+}
+
+/**
+ * \brief Unmap the file.
+ *
+ * Column spans and names obtained from the reader are invalidated.
+ */
+Throw::BinaryReader::~BinaryReader() {
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+}
+
+/**
+ * \brief Get names of all objects in the order they were written.
+ */
+std::vector<std::string> Throw::BinaryReader::getNames() {
+
+  return nameVec;
+}
+
+/**
+ * \brief Test whether the object is present in the file.
+ */
+bool Throw::BinaryReader::hasObject(const std::string& name) {
+
+  return entryMap.find(name) != entryMap.end();
+}
+
+/**
+ * \brief Get index entry of the object.
+ */
+const Throw::BinaryReader::Entry& Throw::BinaryReader::getEntry(
+    const std::string& name) {
+  auto itr = entryMap.find(name);
+  if (itr == entryMap.end()) {
+    throw Exception("Throw::BinaryReader", "Object not found");
+  }
+
+  return itr->second;
+}
+
+/**
+ * \brief Get type of the object, see Throw::BinaryObject.
+ */
+int Throw::BinaryReader::getType(const std::string& name) {
+
+  return getEntry(name).type;
+}
+
+/**
+ * \brief Get title of the object including axis titles separated by ";".
+ */
+std::string Throw::BinaryReader::getTitle(const std::string& name) {
+
+  return getEntry(name).title;
+}
+
+/**
+ * \brief Test whether the object has the column.
+ *
+ * \param name object name.
+ * \param column column type, see Throw::BinaryColumn.
+ */
+bool Throw::BinaryReader::hasColumn(const std::string& name, int column) {
+  if (column < 0 || column >= kNbinaryColumns) {
+    return false;
+  }
+
+  return getEntry(name).columns[column].data != nullptr;
+}
+
+/**
+ * \brief Get column of the object directly from the mapped file.
+ *
+ * Returns empty span if the object doesn't have the column.
+ *
+ * \param name object name.
+ * \param column column type, see Throw::BinaryColumn.
+ */
+Throw::ColumnSpan Throw::BinaryReader::getColumn(const std::string& name,
+                                                 int column) {
+  if (column < 0 || column >= kNbinaryColumns) {
+    throw Exception("Throw::BinaryReader::getColumn", "Out of range");
+  }
+
+  return getEntry(name).columns[column];
+}
+
+/**
+ * \brief Make histogram from the stored columns.
+ *
+ * The caller owns the histogram.
+ */
+TH1D* Throw::BinaryReader::makeHist1D(const std::string& name) {
+  const Entry& entry = getEntry(name);
+  if (entry.type != kBinaryTH1) {
+    throw Exception("Throw::BinaryReader::makeHist1D", "Object is not TH1");
+  }
+
+  const ColumnSpan& xEdges = entry.columns[kBinXedges];
+  const ColumnSpan& content = entry.columns[kBinContent];
+  const ColumnSpan& error = entry.columns[kBinError];
+  if (!xEdges.data || xEdges.size < 2 || !HasSize(content, xEdges.size + 1) ||
+      !HasSize(error, content.size)) {
+    throw Exception("Throw::BinaryReader::makeHist1D", "Corrupted object");
+  }
+  TH1D* hist = new TH1D(name.c_str(), entry.title.c_str(),
+                        xEdges.size - 1, xEdges.data);
+  hist->SetDirectory(nullptr);
+  for (size_t i = 0; i < content.size; ++i) {
+    hist->SetBinContent(i, content.data[i]);
+    hist->SetBinError(i, error.data[i]);
+  }
+  hist->ResetStats();
+
+  return hist;
+}
+
+/**
+ * \brief Make 2D histogram from the stored columns.
+ *
+ * The caller owns the histogram.
+ */
+TH2D* Throw::BinaryReader::makeHist2D(const std::string& name) {
+  const Entry& entry = getEntry(name);
+  if (entry.type != kBinaryTH2) {
+    throw Exception("Throw::BinaryReader::makeHist2D", "Object is not TH2");
+  }
+
+  const ColumnSpan& xEdges = entry.columns[kBinXedges];
+  const ColumnSpan& yEdges = entry.columns[kBinYedges];
+  const ColumnSpan& content = entry.columns[kBinContent];
+  const ColumnSpan& error = entry.columns[kBinError];
+  if (!xEdges.data || xEdges.size < 2 || !yEdges.data || yEdges.size < 2 ||
+      !HasSize(content, (xEdges.size + 1) * (yEdges.size + 1)) ||
+      !HasSize(error, content.size)) {
+    throw Exception("Throw::BinaryReader::makeHist2D", "Corrupted object");
+  }
+  TH2D* hist = new TH2D(name.c_str(), entry.title.c_str(),
+                        xEdges.size - 1, xEdges.data,
+                        yEdges.size - 1, yEdges.data);
+  hist->SetDirectory(nullptr);
+  for (size_t i = 0; i < content.size; ++i) {
+    hist->SetBinContent(i, content.data[i]);
+    hist->SetBinError(i, error.data[i]);
+  }
+  hist->ResetStats();
+
+  return hist;
+}
+
+/**
+ * \brief Make graph from the stored columns.
+ *
+ * Symmetric errors are split into equal low and high errors. The caller owns
+ * the graph.
+ */
+TGraphAsymmErrors* Throw::BinaryReader::makeGraph(const std::string& name) {
+  const Entry& entry = getEntry(name);
+  if (entry.type != kBinaryGraph) {
+    throw Exception("Throw::BinaryReader::makeGraph", "Object is not TGraph");
+  }
+
+  const ColumnSpan* columns = entry.columns;
+  size_t n = columns[kPointX].size;
+  bool isValid = columns[kPointX].data && HasSize(columns[kPointY], n);
+  for (int column : {kPointEX, kPointEY, kPointEXlow, kPointEXhigh,
+                     kPointEYlow, kPointEYhigh}) {
+    isValid = isValid && IsAbsentOrHasSize(columns[column], n);
+  }
+  if (!isValid || !columns[kPointEXlow].data != !columns[kPointEXhigh].data ||
+      !columns[kPointEYlow].data != !columns[kPointEYhigh].data) {
+    throw Exception("Throw::BinaryReader::makeGraph", "Corrupted object");
+  }
+  const double* exl = columns[kPointEXlow].data;
+  const double* exh = columns[kPointEXhigh].data;
+  if (!exl) {
+    exl = columns[kPointEX].data;
+    exh = columns[kPointEX].data;
+  }
+  const double* eyl = columns[kPointEYlow].data;
+  const double* eyh = columns[kPointEYhigh].data;
+  if (!eyl) {
+    eyl = columns[kPointEY].data;
+    eyh = columns[kPointEY].data;
+  }
+
+  TGraphAsymmErrors* graph = new TGraphAsymmErrors(
+      n, columns[kPointX].data, columns[kPointY].data,
+      exl, exh, eyl, eyh);
+  graph->SetName(name.c_str());
+  graph->SetTitle(entry.title.c_str());
+
+  return graph;
+}
+
+/**
+ * \brief Make 2D graph from the stored columns.
+ *
+ * The caller owns the graph.
+ */
+TGraph2D* Throw::BinaryReader::makeGraph2D(const std::string& name) {
+  const Entry& entry = getEntry(name);
+  if (entry.type != kBinaryGraph2D) {
+    throw Exception("Throw::BinaryReader::makeGraph2D",
+                    "Object is not TGraph2D");
+  }
+
+  const ColumnSpan* columns = entry.columns;
+  size_t n = columns[kPointX].size;
+  if (!columns[kPointX].data || !HasSize(columns[kPointY], n) ||
+      !HasSize(columns[kPointZ], n) ||
+      !IsAbsentOrHasSize(columns[kPointEX], n) ||
+      !IsAbsentOrHasSize(columns[kPointEY], n) ||
+      !IsAbsentOrHasSize(columns[kPointEZ], n)) {
+    throw Exception("Throw::BinaryReader::makeGraph2D", "Corrupted object");
+  }
+  TGraph2D* graph;
+  if (columns[kPointEX].data || columns[kPointEY].data ||
+      columns[kPointEZ].data) {
+    TGraph2DErrors* errGraph = new TGraph2DErrors(n);
+    for (size_t i = 0; i < n; ++i) {
+      errGraph->SetPoint(i, columns[kPointX].data[i],
+                            columns[kPointY].data[i],
+                            columns[kPointZ].data[i]);
+      errGraph->SetPointError(
+          i,
+          columns[kPointEX].data ? columns[kPointEX].data[i] : 0.,
+          columns[kPointEY].data ? columns[kPointEY].data[i] : 0.,
+          columns[kPointEZ].data ? columns[kPointEZ].data[i] : 0.);
+    }
+    graph = errGraph;
+  } else {
+    graph = new TGraph2D(n);
+    for (size_t i = 0; i < n; ++i) {
+      graph->SetPoint(i, columns[kPointX].data[i],
+                         columns[kPointY].data[i],
+                         columns[kPointZ].data[i]);
+    }
+  }
+  graph->SetName(name.c_str());
+  graph->SetTitle(entry.title.c_str());
+  graph->SetDirectory(nullptr);
+
+  return graph;
+}
@@ -0,0 +1,296 @@
+/**
+ * \file ThrowBinaryWriter.cxx
+ * \brief Implementation of BinaryWriter.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+// Root
+#include <TH1.h>
+#include <TH2.h>
+#include <TGraph.h>
+#include <TGraph2D.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Create the file and reserve space for the header.
+ *
+ * \param filePath location of the file.
+ */
+Throw::BinaryWriter::BinaryWriter(const std::string& filePath) {
+  file = fopen(filePath.c_str(), "wb");
+  failed = false;
+  offset = 0;
+  nObjects = 0;
+
+  char header[64] = {};
+  writeRaw(header, sizeof(header));
+}
+
+/**
+ * \brief Write the object index and close the file.
+ */
+Throw::BinaryWriter::~BinaryWriter() {
+  close();
+}
+
+/**
+ * \brief Returns whether the file is open and all writes succeeded so far.
+ */
+bool Throw::BinaryWriter::isGood() {
+
+  return file && !failed;
+}
+
+/**
+ * \brief Write bytes to the file and advance the offset.
+ */
+void Throw::BinaryWriter::writeRaw(const void* data, size_t length) {
+  if (!file) {
+    failed = true;
+    return;
+  }
+
+  if (fwrite(data, 1, length, file) != length) {
+    failed = true;
+  }
+  offset += length;
+}
+
+/**
+ * \brief Write columns of an object and append the object to the index.
+ *
+ * \param type object type, see Throw::BinaryObject.
+ * \param name object name.
+ * \param title object title together with axis titles.
+ * \param columns pairs of column type and column content.
+ */
+void Throw::BinaryWriter::addObject(
+    int type,
+    const std::string& name,
+    const std::string& title,
+    const std::vector<std::pair<int, std::vector<double>>>& columns) {
+  if (!nameSet.insert(name).second) {
+    throw Exception("Throw::BinaryWriter", "Object name already written");
+  }
+
+  auto append = [this](const void* data, size_t length) {
+    const char* bytes = static_cast<const char*>(data);
+    index.insert(index.end(), bytes, bytes + length);
+    index.resize((index.size() + 7) / 8 * 8, 0);
+  };
+
+  uint32_t entryHeader[4] = {static_cast<uint32_t>(type),
+                             static_cast<uint32_t>(name.size()),
+                             static_cast<uint32_t>(title.size()),
+                             static_cast<uint32_t>(columns.size())};
+  append(entryHeader, sizeof(entryHeader));
+  append(name.data(), name.size());
+  append(title.data(), title.size());
+
+  char padding[64] = {};
+  for (const auto &column : columns) {
+    writeRaw(padding, (64 - offset % 64) % 64);
+
+    uint64_t descriptor[3] = {static_cast<uint64_t>(column.first),
+                              offset,
+                              column.second.size()};
+    append(descriptor, sizeof(descriptor));
+
+    writeRaw(column.second.data(), column.second.size() * sizeof(double));
+  }
+
+  ++nObjects;
+}
+
+/**
+ * \brief Add histogram to the file.
+ *
+ * Bin contents and errors include underflow and overflow bins.
+ */
+void Throw::BinaryWriter::add(TH1* hist) {
+  if (!hist) {
+    throw Exception("Throw::BinaryWriter::add", "Null TH1* provided");
+  }
+
+  TAxis* xAxis = hist->GetXaxis();
+  std::vector<double> xEdges(xAxis->GetNbins() + 1);
+  for (int i = 0; i < xAxis->GetNbins(); ++i) {
+    xEdges[i] = xAxis->GetBinLowEdge(i + 1);
+  }
+  xEdges.back() = xAxis->GetBinUpEdge(xAxis->GetNbins());
+
+  std::vector<double> content(hist->GetNcells());
+  std::vector<double> error(hist->GetNcells());
+  for (int i = 0; i < hist->GetNcells(); ++i) {
+    content[i] = hist->GetBinContent(i);
+    error[i] = hist->GetBinError(i);
+  }
+
+  std::string title = hist->GetTitle();
+  title += ";";
+  title += xAxis->GetTitle();
+  title += ";";
+  title += hist->GetYaxis()->GetTitle();
+
+  addObject(kBinaryTH1, hist->GetName(), title,
+            {{kBinXedges, xEdges}, {kBinContent, content}, {kBinError, error}});
+}
+
+/**
+ * \brief Add 2D histogram to the file.
+ *
+ * Bin contents and errors include underflow and overflow bins and are ordered
+ * by global bin number.
+ */
+void Throw::BinaryWriter::add(TH2* hist) {
+  if (!hist) {
+    throw Exception("Throw::BinaryWriter::add", "Null TH2* provided");
+  }
+
+  TAxis* xAxis = hist->GetXaxis();
+  std::vector<double> xEdges(xAxis->GetNbins() + 1);
+  for (int i = 0; i < xAxis->GetNbins(); ++i) {
+    xEdges[i] = xAxis->GetBinLowEdge(i + 1);
+  }
+  xEdges.back() = xAxis->GetBinUpEdge(xAxis->GetNbins());
+
+  TAxis* yAxis = hist->GetYaxis();
+  std::vector<double> yEdges(yAxis->GetNbins() + 1);
+  for (int i = 0; i < yAxis->GetNbins(); ++i) {
+    yEdges[i] = yAxis->GetBinLowEdge(i + 1);
+  }
+  yEdges.back() = yAxis->GetBinUpEdge(yAxis->GetNbins());
+
+  std::vector<double> content(hist->GetNcells());
+  std::vector<double> error(hist->GetNcells());
+  for (int i = 0; i < hist->GetNcells(); ++i) {
+    content[i] = hist->GetBinContent(i);
+    error[i] = hist->GetBinError(i);
+  }
+
+  std::string title = hist->GetTitle();
+  title += ";";
+  title += xAxis->GetTitle();
+  title += ";";
+  title += yAxis->GetTitle();
+  title += ";";
+  title += hist->GetZaxis()->GetTitle();
+
+  addObject(kBinaryTH2, hist->GetName(), title,
+            {{kBinXedges, xEdges}, {kBinYedges, yEdges},
+             {kBinContent, content}, {kBinError, error}});
+}
+
+/**
+ * \brief Add graph to the file.
+ *
+ * Error columns are stored only for graphs which have them.
+ */
+void Throw::BinaryWriter::add(TGraph* graph) {
+  if (!graph) {
+    throw Exception("Throw::BinaryWriter::add", "Null TGraph* provided");
+  }
+
+  size_t n = graph->GetN();
+  auto column = [n](const double* arr) {
+    return std::vector<double>(arr, arr + n);
+  };
+
+  std::vector<std::pair<int, std::vector<double>>> columns;
+  columns.emplace_back(kPointX, column(graph->GetX()));
+  columns.emplace_back(kPointY, column(graph->GetY()));
+  if (graph->GetEXlow()) {
+    columns.emplace_back(kPointEXlow, column(graph->GetEXlow()));
+    columns.emplace_back(kPointEXhigh, column(graph->GetEXhigh()));
+  } else if (graph->GetEX()) {
+    columns.emplace_back(kPointEX, column(graph->GetEX()));
+  }
+  if (graph->GetEYlow()) {
+    columns.emplace_back(kPointEYlow, column(graph->GetEYlow()));
+    columns.emplace_back(kPointEYhigh, column(graph->GetEYhigh()));
+  } else if (graph->GetEY()) {
+    columns.emplace_back(kPointEY, column(graph->GetEY()));
+  }
+
+  std::string title = graph->GetTitle();
+  title += ";";
+  title += graph->GetXaxis()->GetTitle();
+  title += ";";
+  title += graph->GetYaxis()->GetTitle();
+
+  addObject(kBinaryGraph, graph->GetName(), title, columns);
+}
+
+/**
+ * \brief Add 2D graph to the file.
+ *
+ * Error columns are stored only for graphs which have them. Only the title
+ * of the graph is stored, axis titles are kept if they were given in it as
+ * "title;x;y;z". Axes of TGraph2D are made by interpolating the graph, they
+ * aren't touched.
+ */
+void Throw::BinaryWriter::add(TGraph2D* graph) {
+  if (!graph) {
+    throw Exception("Throw::BinaryWriter::add", "Null TGraph2D* provided");
+  }
+
+  size_t n = graph->GetN();
+  auto column = [n](const double* arr) {
+    return std::vector<double>(arr, arr + n);
+  };
+
+  std::vector<std::pair<int, std::vector<double>>> columns;
+  columns.emplace_back(kPointX, column(graph->GetX()));
+  columns.emplace_back(kPointY, column(graph->GetY()));
+  columns.emplace_back(kPointZ, column(graph->GetZ()));
+  if (graph->GetEX()) {
+    columns.emplace_back(kPointEX, column(graph->GetEX()));
+  }
+  if (graph->GetEY()) {
+    columns.emplace_back(kPointEY, column(graph->GetEY()));
+  }
+  if (graph->GetEZ()) {
+    columns.emplace_back(kPointEZ, column(graph->GetEZ()));
+  }
+
+  addObject(kBinaryGraph2D, graph->GetName(), graph->GetTitle(), columns);
+}
+
+/**
+ * \brief Write the object index, fill in the header and close the file.
+ */
+bool Throw::BinaryWriter::close() {
+  if (!file) {
+    return false;
+  }
+
+  char padding[64] = {};
+  writeRaw(padding, (64 - offset % 64) % 64);
+  uint64_t indexOffset = offset;
+  writeRaw(index.data(), index.size());
+
+  char header[64] = {};
+  uint32_t version = 1;
+  memcpy(header, "THRWBIN", 8);
+  memcpy(header + 8, &version, sizeof(version));
+  memcpy(header + 12, &nObjects, sizeof(nObjects));
+  memcpy(header + 16, &indexOffset, sizeof(indexOffset));
+  if (fseek(file, 0, SEEK_SET) != 0 ||
+      fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+    failed = true;
+  }
+
+  if (fclose(file) != 0) {
+    failed = true;
+  }
+  file = nullptr;
+
+  return !failed;
+}
@@ -0,0 +1,157 @@
+/**
+ * \file ThrowBufferedWriter.cxx
+ * \brief Implementation of BufferedWriter.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <charconv>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Open file for writing with 1 MiB buffer.
+ *
+ * \param filePath location of the file.
+ */
+Throw::BufferedWriter::BufferedWriter(const std::string& filePath) :
+    BufferedWriter(filePath, 1 << 20) {
+}
+
+/**
+ * \brief Open file for writing.
+ *
+ * \param filePath location of the file.
+ * \param bufferSize size of the output buffer in bytes.
+ */
+Throw::BufferedWriter::BufferedWriter(const std::string& filePath,
+                                      size_t bufferSize) {
+  file = fopen(filePath.c_str(), "wb");
+  if (file) {
+    setvbuf(file, nullptr, _IONBF, 0);
+  }
+  failed = false;
+
+  // Leave space for the longest number representation
+  buffer.resize(bufferSize < 64 ? 64 : bufferSize);
+  used = 0;
+}
+
+/**
+ * \brief Flush the buffer and close the file.
+ */
+Throw::BufferedWriter::~BufferedWriter() {
+  close();
+}
+
+/**
+ * \brief Returns whether the file is open and all writes succeeded so far.
+ */
+bool Throw::BufferedWriter::isGood() {
+
+  return file && !failed;
+}
+
+/**
+ * \brief Write the buffer content to the file.
+ *
+ * Without an open file the content is dropped and the writer fails.
+ */
+bool Throw::BufferedWriter::flush() {
+  if (!file) {
+    used = 0;
+    failed = true;
+    return false;
+  }
+
+  if (used > 0 && fwrite(buffer.data(), 1, used, file) != used) {
+    failed = true;
+  }
+  used = 0;
+
+  return !failed;
+}
+
+/**
+ * \brief Flush the buffer and close the file.
+ */
+bool Throw::BufferedWriter::close() {
+  if (!file) {
+    return false;
+  }
+
+  flush();
+  if (fclose(file) != 0) {
+    failed = true;
+  }
+  file = nullptr;
+
+  return !failed;
+}
+
+/**
+ * \brief Append a string.
+ */
+void Throw::BufferedWriter::write(const std::string& str) {
+  write(str.data(), str.size());
+}
+
+/**
+ * \brief Append a sequence of characters.
+ */
+void Throw::BufferedWriter::write(const char* str, size_t length) {
+  if (used + length > buffer.size()) {
+    flush();
+  }
+
+  if (length > buffer.size()) {
+    if (file && fwrite(str, 1, length, file) != length) {
+      failed = true;
+    }
+    return;
+  }
+
+  memcpy(buffer.data() + used, str, length);
+  used += length;
+}
+
+/**
+ * \brief Append a character.
+ */
+void Throw::BufferedWriter::write(char c) {
+  if (used == buffer.size()) {
+    flush();
+  }
+
+  buffer[used++] = c;
+}
+
+/**
+ * \brief Append a number in the shortest representation which reads back to
+ * the same value.
+ */
+void Throw::BufferedWriter::write(double val) {
+  if (buffer.size() - used < 32) {
+    flush();
+  }
+
+  char* begin = buffer.data() + used;
+  used += std::to_chars(begin, begin + 32, val).ptr - begin;
+}
+
+/**
+ * \brief Append an integer.
+ */
+void Throw::BufferedWriter::write(long long val) {
+  if (buffer.size() - used < 32) {
+    flush();
+  }
+
+  char* begin = buffer.data() + used;
+  used += std::to_chars(begin, begin + 32, val).ptr - begin;
+}
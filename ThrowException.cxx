@@ -0,0 +1,41 @@
+/**
+ * \file ThrowException.cxx
+ * \brief Implementation of Exception.
+ */
+
+
+// std
+#include <string>
+#include <stdexcept>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Constructor of Exception.
+ *
+ * \param where function or class which failed, e.g. "Throw::Plotter1D".
+ * \param message description of the error, without the final "!".
+ */
+Throw::Exception::Exception(const std::string& where,
+                            const std::string& message) :
+    std::runtime_error("ERROR: " + where + " -- " + message + "!"),
+    where(where),
+    message(message) {
+}
+
+/**
+ * \brief Get function or class which failed.
+ */
+const std::string& Throw::Exception::getWhere() const {
+
+  return where;
+}
+
+/**
+ * \brief Get description of the error.
+ */
+const std::string& Throw::Exception::getMessage() const {
+
+  return message;
+}
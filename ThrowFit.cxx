@@ -0,0 +1,169 @@
+/**
+ * \file ThrowFit.cxx
+ * \brief Implementation of the fitting related functions.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cctype>
+// Root
+#include <TROOT.h>
+#include <TH1.h>
+#include <TF1.h>
+#include <TFitResultPtr.h>
+#include <Foption.h>
+#include <HFitInterface.h>
+#include <Fit/DataRange.h>
+#include <Math/MinimizerOptions.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \ingroup Fit
+ * \brief Fit the function to every histogram, uses one thread per hardware
+ * core.
+ *
+ * \param hists histograms to be fitted.
+ * \param func template of the fitted function.
+ */
+std::vector<Throw::FitResult> Throw::FitBatch(const std::vector<TH1*>& hists,
+                                              TF1* func) {
+
+  return FitBatch(hists, func, "", std::thread::hardware_concurrency());
+}
+
+/**
+ * \ingroup Fit
+ * \brief Fit the function to every histogram, uses one thread per hardware
+ * core.
+ *
+ * \param hists histograms to be fitted.
+ * \param func template of the fitted function.
+ * \param options fit options of TH1::Fit.
+ */
+std::vector<Throw::FitResult> Throw::FitBatch(const std::vector<TH1*>& hists,
+                                              TF1* func,
+                                              const std::string& options) {
+
+  return FitBatch(hists, func, options, std::thread::hardware_concurrency());
+}
+
+/**
+ * \ingroup Fit
+ * \brief Fit the function to every histogram in parallel.
+ *
+ * Every histogram is fitted with its own clone of the function, starting
+ * from the parameters of the template. The fits are quiet unless option "V"
+ * is given and the functions aren't stored in the histograms, they are
+ * returned ready to be added to a plotter. TMinuit isn't thread safe, fits
+ * running in parallel use Minuit2 instead of it, the default minimizer of ROOT
+ * is left untouched. Fitting in parallel enables the thread safety of ROOT
+ * for the rest of the program.
+ *
+ * \param hists histograms to be fitted.
+ * \param func template of the fitted function, it's not modified.
+ * \param options fit options of TH1::Fit.
+ * \param nThreads number of threads.
+ *
+ * \return results in the order of the histograms.
+ */
+std::vector<Throw::FitResult> Throw::FitBatch(const std::vector<TH1*>& hists,
+                                              TF1* func,
+                                              const std::string& options,
+                                              size_t nThreads) {
+  THROW_TRACE("Throw::FitBatch");
+  if (!func) {
+    throw Exception("Throw::FitBatch", "Null TF1* provided");
+  }
+  for (auto &hist : hists) {
+    if (!hist) {
+      throw Exception("Throw::FitBatch", "Null TH1* provided");
+    }
+  }
+
+  std::string fitOptions = options;
+  bool verbose = false;
+  for (char option : options) {
+    if (std::toupper(option) == 'V') {
+      verbose = true;
+    }
+  }
+  if (!verbose) {
+    fitOptions += "Q";
+  }
+  fitOptions += "N";
+
+  // Functions are cloned on this thread, each fit owns its clone
+  std::vector<FitResult> results(hists.size());
+  for (size_t i = 0; i < hists.size(); ++i) {
+    std::string name = std::string(hists.at(i)->GetName()) + "_" +
+                       func->GetName();
+    results.at(i).hist = hists.at(i);
+    results.at(i).func = dynamic_cast<TF1*>(func->Clone(name.c_str()));
+    results.at(i).status = -1;
+    results.at(i).chi2 = 0.;
+    results.at(i).ndf = 0;
+  }
+
+  if (nThreads < 1) {
+    nThreads = 1;
+  }
+  if (nThreads > hists.size()) {
+    nThreads = hists.size();
+  }
+
+  // Same as TH1::Fit, but the minimizer is chosen per fit
+  Foption_t fitOption;
+  ROOT::Fit::FitOptionsMake(ROOT::Fit::EFitObjectType::kHistogram,
+                            fitOptions.c_str(), fitOption);
+  ROOT::Math::MinimizerOptions minimizerOptions;
+  std::string minimizerType = minimizerOptions.MinimizerType();
+  if (nThreads > 1 && (minimizerType.compare("Minuit") == 0 ||
+                       minimizerType.compare("TMinuit") == 0)) {
+    minimizerOptions.SetMinimizerType("Minuit2");
+  }
+  if (nThreads > 1) {
+    ROOT::EnableThreadSafety();
+  }
+
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < results.size(); i = next++) {
+      THROW_TRACE("Throw::FitBatch::fit");
+      FitResult& result = results[i];
+      Foption_t option = fitOption;
+      ROOT::Fit::DataRange range;
+      result.status = ROOT::Fit::FitObject(result.hist, result.func, option,
+                                           minimizerOptions, "", range);
+      result.chi2 = result.func->GetChisquare();
+      result.ndf = result.func->GetNDF();
+    }
+  };
+
+  std::vector<std::thread> threadVec;
+  for (size_t i = 0; i < nThreads; ++i) {
+    threadVec.emplace_back(worker);
+  }
+  for (auto &thread : threadVec) {
+    thread.join();
+  }
+
+  size_t nFailed = 0;
+  for (auto &result : results) {
+    if (result.status != 0) {
+      ++nFailed;
+    }
+  }
+  if (nFailed > 0) {
+    THROW_LOG_WARNING("Throw::FitBatch -- Failed fits: " +
+                      std::to_string(nFailed) + " of " +
+                      std::to_string(results.size()));
+  }
+
+  return results;
+}
@@ -19,7 +19,7 @@
 double Throw::GetPointX(TGraph* graph, size_t index) {
   double* xArr = graph->GetX();
   if (index < 0 || index >= graph->GetN()) {
-    throw "ERROR: Out of range!";
+    throw Exception("Throw::GetPointX", "Out of range");
   }
 
   return xArr[index];
@@ -32,7 +32,7 @@ double Throw::GetPointX(TGraph* graph, size_t index) {
 double Throw::GetPointY(TGraph* graph, size_t index) {
   double* yArr = graph->GetY();
   if (index < 0 || index >= graph->GetN()) {
-    throw "ERROR: Out of range!";
+    throw Exception("Throw::GetPointY", "Out of range");
   }
 
   return yArr[index];
@@ -63,7 +63,7 @@ void Throw::SetPointY(TGraph* graph, size_t index, double val) {
 double Throw::GetPointX(TGraphAsymmErrors* graph, size_t index) {
   double* xArr = graph->GetX();
   if (index < 0 || index >= graph->GetN()) {
-    throw "ERROR: Out of range!";
+    throw Exception("Throw::GetPointX", "Out of range");
   }
 
   return xArr[index];
@@ -76,7 +76,7 @@ double Throw::GetPointX(TGraphAsymmErrors* graph, size_t index) {
 double Throw::GetPointY(TGraphAsymmErrors* graph, size_t index) {
   double* yArr = graph->GetY();
   if (index < 0 || index >= graph->GetN()) {
-    throw "ERROR: Out of range!";
+    throw Exception("Throw::GetPointY", "Out of range");
   }
 
   return yArr[index];
@@ -107,7 +107,7 @@ void Throw::SetPointY(TGraphAsymmErrors* graph, size_t index, double val) {
 double Throw::GetPointX(TGraph2D* graph, size_t index) {
   double* xArr = graph->GetX();
   if (index < 0 || index >= graph->GetN()) {
-    throw "ERROR: Out of range!";
+    throw Exception("Throw::GetPointX", "Out of range");
   }
 
   return xArr[index];
@@ -120,7 +120,7 @@ double Throw::GetPointX(TGraph2D* graph, size_t index) {
 double Throw::GetPointY(TGraph2D* graph, size_t index) {
   double* yArr = graph->GetY();
   if (index < 0 || index >= graph->GetN()) {
-    throw "ERROR: Out of range!";
+    throw Exception("Throw::GetPointY", "Out of range");
   }
 
   return yArr[index];
@@ -133,7 +133,7 @@ double Throw::GetPointY(TGraph2D* graph, size_t index) {
 double Throw::GetPointZ(TGraph2D* graph, size_t index) {
   double* zArr = graph->GetZ();
   if (index < 0 || index >= graph->GetN()) {
-    throw "ERROR: Out of range!";
+    throw Exception("Throw::GetPointZ", "Out of range");
   }
 
   return zArr[index];
@@ -0,0 +1,272 @@
+/**
+ * \file ThrowGraphPyramid.cxx
+ * \brief Implementation of GraphPyramid.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <algorithm>
+// Root
+#include <TFile.h>
+#include <TGraphAsymmErrors.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Build the pyramid from a graph.
+ *
+ * Level 0 holds copy of the graph points sorted in x. Every following level
+ * merges pairs of neighbouring buckets of the previous one, the last level
+ * consists of a single bucket.
+ *
+ * \param graph graph to be summarized, its y errors are included in the
+ * minimum/maximum envelope.
+ */
+Throw::GraphPyramid::GraphPyramid(TGraph* graph) {
+  if (!graph) {
+    throw Exception("Throw::GraphPyramid", "Null TGraph* provided");
+  }
+  if (graph->GetN() < 1) {
+    throw Exception("Throw::GraphPyramid", "Empty graph provided");
+  }
+
+  name = graph->GetName();
+
+  size_t nPoints = graph->GetN();
+  double* eyLow = graph->GetEYlow();
+  double* eyHigh = graph->GetEYhigh();
+  TGraphAsymmErrors* level = new TGraphAsymmErrors(nPoints);
+  for (size_t i = 0; i < nPoints; ++i) {
+    level->SetPoint(i, graph->GetX()[i], graph->GetY()[i]);
+    level->SetPointError(i, 0., 0.,
+                         eyLow ? eyLow[i] : 0.,
+                         eyHigh ? eyHigh[i] : 0.);
+  }
+  level->Sort();
+  level->SetName((name + "_level_0").c_str());
+  level->SetTitle(graph->GetTitle());
+  level->GetXaxis()->SetTitle(graph->GetXaxis()->GetTitle());
+  level->GetYaxis()->SetTitle(graph->GetYaxis()->GetTitle());
+  levelVec.emplace_back(level);
+
+  size_t bucketSize = 1;
+  while (level->GetN() > 1) {
+    size_t nPrev = level->GetN();
+    double* x = level->GetX();
+    double* y = level->GetY();
+    double* exl = level->GetEXlow();
+    double* exh = level->GetEXhigh();
+    double* eyl = level->GetEYlow();
+    double* eyh = level->GetEYhigh();
+
+    TGraphAsymmErrors* nextLevel = new TGraphAsymmErrors((nPrev + 1) / 2);
+    for (size_t i = 0; i < (nPrev + 1) / 2; ++i) {
+      size_t a = 2 * i;
+      size_t b = std::min(a + 1, nPrev - 1);
+
+      double xLow = x[a] - exl[a];
+      double xUp = x[b] + exh[b];
+      double yMin = std::min(y[a] - eyl[a], y[b] - eyl[b]);
+      double yMax = std::max(y[a] + eyh[a], y[b] + eyh[b]);
+
+      double nA = std::min(bucketSize, nPoints - a * bucketSize);
+      double nB = 0.;
+      if (b != a) {
+        nB = std::min(bucketSize, nPoints - b * bucketSize);
+      }
+      double yMean = (nA * y[a] + nB * y[b]) / (nA + nB);
+      double xMid = 0.5 * (xLow + xUp);
+
+      nextLevel->SetPoint(i, xMid, yMean);
+      nextLevel->SetPointError(i, xMid - xLow, xUp - xMid,
+                               yMean - yMin, yMax - yMean);
+    }
+    bucketSize *= 2;
+
+    std::string levelName = name + "_level_";
+    levelName += std::to_string(levelVec.size());
+    nextLevel->SetName(levelName.c_str());
+    nextLevel->SetTitle(graph->GetTitle());
+    levelVec.emplace_back(nextLevel);
+    level = nextLevel;
+  }
+}
+
+/**
+ * \brief Load the pyramid stored by GraphPyramid::write.
+ *
+ * \param filePath path of the root file.
+ * \param pyramidName name of the summarized graph.
+ */
+Throw::GraphPyramid::GraphPyramid(const std::string& filePath,
+                                  const std::string& pyramidName) {
+  name = pyramidName;
+
+  TFile* inFile = TFile::Open(filePath.c_str(), "READ");
+  if (!inFile || inFile->IsZombie()) {
+    delete inFile;
+    throw Exception("Throw::GraphPyramid", "Can't open pyramid file");
+  }
+
+  TDirectory* dir = inFile->GetDirectory((name + "_pyramid").c_str());
+  if (dir) {
+    while (true) {
+      std::string levelName = "level_" + std::to_string(levelVec.size());
+      TGraphAsymmErrors* level = dir->Get<TGraphAsymmErrors>(
+          levelName.c_str());
+      if (!level) {
+        break;
+      }
+      levelVec.emplace_back(level);
+    }
+  }
+
+  inFile->Close();
+  delete inFile;
+
+  if (levelVec.empty()) {
+    throw Exception("Throw::GraphPyramid", "Pyramid not found in the file");
+  }
+}
+
+/**
+ * \brief Default destructor of GraphPyramid.
+ */
+Throw::GraphPyramid::~GraphPyramid() {
+  for (auto &level : levelVec) {
+    delete level;
+  }
+
+  levelVec.clear();
+}
+
+/**
+ * \brief Get name of the summarized graph.
+ */
+std::string Throw::GraphPyramid::getName() {
+
+  return name;
+}
+
+/**
+ * \brief Get number of pyramid levels.
+ */
+size_t Throw::GraphPyramid::getNlevels() {
+
+  return levelVec.size();
+}
+
+/**
+ * \brief Get pyramid level.
+ *
+ * Buckets are stored as graph points, bucket x extent in x errors and
+ * minimum/maximum in y errors around the mean.
+ *
+ * \param index level index, level 0 holds the original points.
+ */
+TGraphAsymmErrors* Throw::GraphPyramid::getLevel(size_t index) {
+  if (index >= levelVec.size()) {
+    throw Exception("Throw::GraphPyramid::getLevel", "Out of range");
+  }
+
+  return levelVec.at(index);
+}
+
+/**
+ * \brief Pick the coarsest level which still resolves the x-window.
+ *
+ * \param xMin lower edge of the window.
+ * \param xMax upper edge of the window.
+ * \param nPixels width of the window in pixels.
+ */
+size_t Throw::GraphPyramid::pickLevel(double xMin, double xMax, int nPixels) {
+  TGraphAsymmErrors* level = levelVec.front();
+  double* x = level->GetX();
+  double* xEnd = x + level->GetN();
+
+  size_t nPoints = level->GetN();
+  if (xMax > xMin) {
+    nPoints = std::upper_bound(x, xEnd, xMax) - std::lower_bound(x, xEnd, xMin);
+  }
+
+  size_t index = 0;
+  while (index + 1 < levelVec.size() &&
+         (nPoints >> index) > 2 * static_cast<size_t>(std::max(nPixels, 1))) {
+    ++index;
+  }
+
+  return index;
+}
+
+/**
+ * \brief Make graph of the x-window from the level matching its resolution.
+ *
+ * Cost of the call is proportional to the number of pixels, not to the number
+ * of points in the window. Returns nullptr if the window is empty.
+ *
+ * \param xMin lower edge of the window.
+ * \param xMax upper edge of the window, full range is used if it's not above
+ * the lower edge.
+ * \param nPixels width of the window in pixels.
+ */
+TGraphAsymmErrors* Throw::GraphPyramid::makeWindow(double xMin, double xMax,
+                                                   int nPixels) {
+  TGraphAsymmErrors* level = levelVec.at(pickLevel(xMin, xMax, nPixels));
+  double* x = level->GetX();
+  double* exl = level->GetEXlow();
+  double* exh = level->GetEXhigh();
+
+  size_t first = 0;
+  size_t last = level->GetN();
+  if (xMax > xMin) {
+    first = std::partition_point(x, x + last, [&](const double& xi) {
+      return xi + exh[&xi - x] < xMin;
+    }) - x;
+    last = std::partition_point(x, x + last, [&](const double& xi) {
+      return xi - exl[&xi - x] <= xMax;
+    }) - x;
+  }
+
+  if (last <= first) {
+    return nullptr;
+  }
+
+  TGraphAsymmErrors* graph = new TGraphAsymmErrors(
+      last - first,
+      x + first, level->GetY() + first,
+      exl + first, exh + first,
+      level->GetEYlow() + first, level->GetEYhigh() + first);
+  graph->SetName((name + "_window").c_str());
+  graph->SetTitle(levelVec.front()->GetTitle());
+  graph->GetXaxis()->SetTitle(levelVec.front()->GetXaxis()->GetTitle());
+  graph->GetYaxis()->SetTitle(levelVec.front()->GetYaxis()->GetTitle());
+
+  return graph;
+}
+
+/**
+ * \brief Store the pyramid to a root file.
+ *
+ * The file is updated, so the pyramid can be stored next to the graph it
+ * summarizes.
+ *
+ * \param filePath path of the root file.
+ */
+void Throw::GraphPyramid::write(const std::string& filePath) {
+  TFile* outFile = new TFile(filePath.c_str(), "UPDATE");
+  if (outFile->IsOpen()) {
+    TDirectory* dir = outFile->mkdir((name + "_pyramid").c_str(), "", true);
+    for (size_t i = 0; i < levelVec.size(); ++i) {
+      dir->WriteTObject(levelVec.at(i),
+                        ("level_" + std::to_string(i)).c_str(),
+                        "Overwrite");
+    }
+    outFile->Write();
+    outFile->Close();
+  }
+
+  delete outFile;
+}
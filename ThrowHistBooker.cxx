@@ -0,0 +1,342 @@
+/**
+ * \file ThrowHistBooker.cxx
+ * \brief Implementation of HistBooker.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+// Root
+#include <TROOT.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <ROOT/RDataFrame.hxx>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Sets the implicit multithreading of ROOT for one event loop and
+ * restores the previous setting when destroyed.
+ */
+class ImplicitMTScope {
+  public:
+    explicit ImplicitMTScope(size_t nThreads) {
+      wasEnabled = ROOT::IsImplicitMTEnabled();
+      poolSize = wasEnabled ? ROOT::GetThreadPoolSize() : 0;
+      size_t wanted = nThreads > 1 ? nThreads : 0;
+      if (wanted != poolSize) {
+        if (wasEnabled) {
+          ROOT::DisableImplicitMT();
+        }
+        if (wanted > 0) {
+          ROOT::EnableImplicitMT(wanted);
+        }
+      }
+    }
+
+    ~ImplicitMTScope() {
+      bool isEnabled = ROOT::IsImplicitMTEnabled();
+      if (isEnabled == wasEnabled &&
+          (!isEnabled || ROOT::GetThreadPoolSize() == poolSize)) {
+        return;
+      }
+      if (isEnabled) {
+        ROOT::DisableImplicitMT();
+      }
+      if (wasEnabled) {
+        ROOT::EnableImplicitMT(poolSize);
+      }
+    }
+
+  private:
+    bool wasEnabled;
+    unsigned poolSize;
+};
+
+/**
+ * \brief Constructor of HistBooker.
+ *
+ * \param treeName name of the tree.
+ * \param filePath root file with the tree.
+ */
+Throw::HistBooker::HistBooker(const std::string& treeName,
+                              const std::string& filePath) {
+  cache = nullptr;
+  this->treeName = treeName;
+  filePathVec.emplace_back(filePath);
+}
+
+/**
+ * \brief Constructor of HistBooker.
+ *
+ * \param treeName name of the tree.
+ * \param filePaths root files with the tree, chained together.
+ */
+Throw::HistBooker::HistBooker(const std::string& treeName,
+                              const std::vector<std::string>& filePaths) {
+  cache = nullptr;
+  this->treeName = treeName;
+  filePathVec = filePaths;
+}
+
+/**
+ * \brief Destructor of HistBooker, deletes the histograms.
+ */
+Throw::HistBooker::~HistBooker() {
+  clear();
+}
+
+/**
+ * \brief Delete filled histograms.
+ */
+void Throw::HistBooker::clear() {
+  for (auto &hist : hist1DMap) {
+    delete hist.second;
+  }
+  for (auto &hist : hist2DMap) {
+    delete hist.second;
+  }
+  hist1DMap.clear();
+  hist2DMap.clear();
+}
+
+/**
+ * \brief Book histogram, it is filled by the next run.
+ *
+ * \param definition definition of the histogram, the name has to be unique.
+ */
+void Throw::HistBooker::book(const HistDefinition& definition) {
+  if (definition.name.empty() || definition.xExpression.empty()) {
+    throw Exception("Throw::HistBooker::book", "Missing name or expression");
+  }
+  for (const auto &booked : definitionVec) {
+    if (booked.name.compare(definition.name) == 0) {
+      throw Exception("Throw::HistBooker::book", "Histogram already booked");
+    }
+  }
+
+  definitionVec.emplace_back(definition);
+}
+
+/**
+ * \brief Book one-dimensional histogram of all entries.
+ *
+ * \param name name of the histogram.
+ * \param title title of the histogram, e.g. "Title;x label;y label".
+ * \param expression filled expression.
+ */
+void Throw::HistBooker::book1D(const std::string& name,
+                               const std::string& title,
+                               const std::string& expression,
+                               int nBins, double xMin, double xMax) {
+  HistDefinition definition = {name, title, expression, "", "", "",
+                               nBins, xMin, xMax, 0, 0., 0.};
+  book(definition);
+}
+
+/**
+ * \brief Book two-dimensional histogram of all entries.
+ *
+ * \param name name of the histogram.
+ * \param title title of the histogram.
+ * \param xExpression expression on the x axis.
+ * \param yExpression expression on the y axis.
+ */
+void Throw::HistBooker::book2D(const std::string& name,
+                               const std::string& title,
+                               const std::string& xExpression,
+                               const std::string& yExpression,
+                               int nBinsX, double xMin, double xMax,
+                               int nBinsY, double yMin, double yMax) {
+  HistDefinition definition = {name, title, xExpression, yExpression, "", "",
+                               nBinsX, xMin, xMax, nBinsY, yMin, yMax};
+  book(definition);
+}
+
+/**
+ * \brief Set cache of the filled histograms.
+ *
+ * Cached histograms are loaded instead of filled, newly filled histograms are
+ * stored in the cache.
+ *
+ * \param cache cache owned by the caller, nullptr disables caching.
+ */
+void Throw::HistBooker::setCache(HistCache* cache) {
+  this->cache = cache;
+}
+
+/**
+ * \brief Fill all booked histograms, uses one thread per hardware core.
+ */
+void Throw::HistBooker::run() {
+  run(std::thread::hardware_concurrency());
+}
+
+/**
+ * \brief Fill all booked histograms in one pass over the tree.
+ *
+ * Every distinct expression is computed once per entry and every distinct cut
+ * is evaluated once per entry. Histograms from the previous run are deleted.
+ * Histograms found in the cache are not filled, the event loop is skipped if
+ * all of them are cached.
+ *
+ * \param nThreads number of threads. Implicit multithreading of ROOT is set to
+ * the number of threads for the event loop, the previous setting is restored
+ * afterwards.
+ */
+void Throw::HistBooker::run(size_t nThreads) {
+  clear();
+  if (definitionVec.empty()) {
+    return;
+  }
+
+  std::vector<std::string> keyVec(definitionVec.size());
+  std::vector<size_t> missingVec;
+  for (size_t i = 0; i < definitionVec.size(); ++i) {
+    const HistDefinition& definition = definitionVec.at(i);
+    TH1* hist = nullptr;
+    if (cache) {
+      keyVec.at(i) = cache->makeKey(treeName, filePathVec, definition);
+      hist = cache->load(keyVec.at(i));
+    }
+    if (!hist) {
+      missingVec.emplace_back(i);
+    } else if (definition.yExpression.empty() && dynamic_cast<TH1D*>(hist)) {
+      hist->SetNameTitle(definition.name.c_str(), definition.title.c_str());
+      hist1DMap[definition.name] = dynamic_cast<TH1D*>(hist);
+    } else if (!definition.yExpression.empty() && dynamic_cast<TH2D*>(hist)) {
+      hist->SetNameTitle(definition.name.c_str(), definition.title.c_str());
+      hist2DMap[definition.name] = dynamic_cast<TH2D*>(hist);
+    } else {
+      delete hist;
+      cache->invalidate(keyVec.at(i));
+      missingVec.emplace_back(i);
+    }
+  }
+  if (missingVec.empty()) {
+    return;
+  }
+
+  // Declared before the data frame, it's restored after the frame is gone
+  ImplicitMTScope implicitMT(nThreads);
+  ROOT::RDataFrame frame(treeName, filePathVec);
+  ROOT::RDF::RNode base = frame;
+
+  // Columns have to be defined before the filters are branched off
+  std::map<std::string, std::string> columnMap;
+  auto defineColumn = [&](const std::string& expression) {
+    if (expression.empty() || columnMap.count(expression)) {
+      return;
+    }
+    std::string column = "throwColumn" + std::to_string(columnMap.size());
+    base = base.Define(column, expression);
+    columnMap[expression] = column;
+  };
+  for (size_t i : missingVec) {
+    const HistDefinition& definition = definitionVec.at(i);
+    defineColumn(definition.xExpression);
+    defineColumn(definition.yExpression);
+    defineColumn(definition.weight);
+  }
+
+  std::map<std::string, ROOT::RDF::RNode> nodeMap;
+  nodeMap.emplace("", base);
+  for (size_t i : missingVec) {
+    const HistDefinition& definition = definitionVec.at(i);
+    if (!nodeMap.count(definition.cut)) {
+      nodeMap.emplace(definition.cut, base.Filter(definition.cut));
+    }
+  }
+
+  std::vector<std::pair<size_t, ROOT::RDF::RResultPtr<TH1D>>> result1DVec;
+  std::vector<std::pair<size_t, ROOT::RDF::RResultPtr<TH2D>>> result2DVec;
+  for (size_t i : missingVec) {
+    const HistDefinition& definition = definitionVec.at(i);
+    ROOT::RDF::RNode& node = nodeMap.at(definition.cut);
+    const std::string& xColumn = columnMap[definition.xExpression];
+
+    if (definition.yExpression.empty()) {
+      ROOT::RDF::TH1DModel model(definition.name.c_str(),
+                                 definition.title.c_str(),
+                                 definition.nBinsX,
+                                 definition.xMin, definition.xMax);
+      if (definition.weight.empty()) {
+        result1DVec.emplace_back(i, node.Histo1D(model, xColumn));
+      } else {
+        result1DVec.emplace_back(
+            i, node.Histo1D(model, xColumn, columnMap[definition.weight]));
+      }
+    } else {
+      const std::string& yColumn = columnMap[definition.yExpression];
+      ROOT::RDF::TH2DModel model(definition.name.c_str(),
+                                 definition.title.c_str(),
+                                 definition.nBinsX,
+                                 definition.xMin, definition.xMax,
+                                 definition.nBinsY,
+                                 definition.yMin, definition.yMax);
+      if (definition.weight.empty()) {
+        result2DVec.emplace_back(i, node.Histo2D(model, xColumn, yColumn));
+      } else {
+        result2DVec.emplace_back(
+            i, node.Histo2D(model, xColumn, yColumn,
+                            columnMap[definition.weight]));
+      }
+    }
+  }
+
+  // Event loop runs once, at the first access to any result
+  for (auto &result : result1DVec) {
+    const std::string& name = definitionVec.at(result.first).name;
+    TH1D* hist = dynamic_cast<TH1D*>(result.second->Clone(name.c_str()));
+    hist->SetDirectory(nullptr);
+    hist1DMap[name] = hist;
+    if (cache) {
+      cache->store(keyVec.at(result.first), hist);
+    }
+  }
+  for (auto &result : result2DVec) {
+    const std::string& name = definitionVec.at(result.first).name;
+    TH2D* hist = dynamic_cast<TH2D*>(result.second->Clone(name.c_str()));
+    hist->SetDirectory(nullptr);
+    hist2DMap[name] = hist;
+    if (cache) {
+      cache->store(keyVec.at(result.first), hist);
+    }
+  }
+}
+
+/**
+ * \brief Get filled one-dimensional histogram.
+ *
+ * \param name name of the histogram.
+ *
+ * \return histogram owned by the booker, nullptr if not filled.
+ */
+TH1D* Throw::HistBooker::getHist1D(const std::string& name) {
+  auto itr = hist1DMap.find(name);
+  if (itr == hist1DMap.end()) {
+    return nullptr;
+  }
+
+  return itr->second;
+}
+
+/**
+ * \brief Get filled two-dimensional histogram.
+ *
+ * \param name name of the histogram.
+ *
+ * \return histogram owned by the booker, nullptr if not filled.
+ */
+TH2D* Throw::HistBooker::getHist2D(const std::string& name) {
+  auto itr = hist2DMap.find(name);
+  if (itr == hist2DMap.end()) {
+    return nullptr;
+  }
+
+  return itr->second;
+}
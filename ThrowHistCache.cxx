@@ -0,0 +1,322 @@
+/**
+ * \file ThrowHistCache.cxx
+ * \brief Implementation of HistCache.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+// POSIX
+#include <unistd.h>
+// Root
+#include <TFile.h>
+#include <TKey.h>
+#include <TH1.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Version of the key, change it when the stored content changes.
+ */
+static const char* kKeyVersion = "ThrowHistCache2";
+
+/**
+ * \brief Default size limit of the cache, 1 GiB.
+ */
+static const uint64_t kDefaultMaxSize = uint64_t(1) << 30;
+
+/**
+ * \brief Add the string to the FNV-1a hash, with its length, so that
+ * concatenations can't collide.
+ */
+static void HashString(uint64_t& hash, const std::string& str) {
+  std::string data = std::to_string(str.size()) + ":" + str;
+  for (unsigned char character : data) {
+    hash ^= character;
+    hash *= 1099511628211ULL;
+  }
+}
+
+/**
+ * \brief Add the number to the hash, exactly.
+ */
+static void HashNumber(uint64_t& hash, double number) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.17g", number);
+  HashString(hash, buffer);
+}
+
+/**
+ * \brief Constructor of HistCache with 1 GiB size limit.
+ *
+ * \param cacheDir cache directory, created if needed.
+ */
+Throw::HistCache::HistCache(const std::string& cacheDir) :
+    HistCache(cacheDir, kDefaultMaxSize) {
+}
+
+/**
+ * \brief Constructor of HistCache.
+ *
+ * \param cacheDir cache directory, created if needed.
+ * \param maxSize size limit of the cache in bytes.
+ */
+Throw::HistCache::HistCache(const std::string& cacheDir, uint64_t maxSize) {
+  this->cacheDir = cacheDir;
+  this->maxSize = maxSize;
+
+  std::error_code error;
+  std::filesystem::create_directories(cacheDir, error);
+  if (error) {
+    throw Exception("Throw::HistCache", "Can't create cache directory");
+  }
+  size = getSize();
+}
+
+/**
+ * \brief Get path of the cache file of the key.
+ */
+std::string Throw::HistCache::getFilePath(const std::string& key) {
+
+  return cacheDir + "/" + key + ".root";
+}
+
+/**
+ * \brief Make key of the histogram.
+ *
+ * Changing size or modification time of any input file changes the key.
+ * Name and title of the histogram are not part of the key, histograms which
+ * differ only in them share the entry.
+ *
+ * \param treeName name of the tree.
+ * \param filePaths input root files.
+ * \param definition definition of the histogram.
+ *
+ * \return key, or empty string if an input file is missing.
+ */
+std::string Throw::HistCache::makeKey(
+    const std::string& treeName,
+    const std::vector<std::string>& filePaths,
+    const HistDefinition& definition) {
+  uint64_t hash = 14695981039346656037ULL;
+  HashString(hash, kKeyVersion);
+  HashString(hash, treeName);
+
+  for (const auto &filePath : filePaths) {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(filePath, error);
+    if (error) {
+      return "";
+    }
+    auto mtime = std::filesystem::last_write_time(filePath, error);
+    if (error) {
+      return "";
+    }
+    HashString(hash, std::filesystem::absolute(filePath).string());
+    HashString(hash, std::to_string(size));
+    HashString(hash, std::to_string(mtime.time_since_epoch().count()));
+  }
+
+  HashString(hash, definition.xExpression);
+  HashString(hash, definition.yExpression);
+  HashString(hash, definition.cut);
+  HashString(hash, definition.weight);
+  HashNumber(hash, definition.nBinsX);
+  HashNumber(hash, definition.xMin);
+  HashNumber(hash, definition.xMax);
+  HashNumber(hash, definition.nBinsY);
+  HashNumber(hash, definition.yMin);
+  HashNumber(hash, definition.yMax);
+
+  char key[17];
+  snprintf(key, sizeof(key), "%016llx", (unsigned long long) hash);
+
+  return key;
+}
+
+/**
+ * \brief Load histogram from the cache.
+ *
+ * Marks the entry as recently used.
+ *
+ * \param key key of the histogram.
+ *
+ * \return histogram owned by the caller, nullptr if not cached.
+ */
+TH1* Throw::HistCache::load(const std::string& key) {
+  if (key.empty()) {
+    return nullptr;
+  }
+  std::string filePath = getFilePath(key);
+  if (!FileExists(filePath)) {
+    return nullptr;
+  }
+
+  TDirectory::TContext context;
+  TFile* inFile = TFile::Open(filePath.c_str(), "READ");
+  if (!inFile || inFile->IsZombie()) {
+    delete inFile;
+    invalidate(key);
+    return nullptr;
+  }
+
+  TH1* hist = nullptr;
+  TKey* histKey = dynamic_cast<TKey*>(inFile->GetListOfKeys()->First());
+  if (histKey) {
+    hist = dynamic_cast<TH1*>(histKey->ReadObj());
+  }
+  if (hist) {
+    hist->SetDirectory(nullptr);
+  }
+  inFile->Close();
+  delete inFile;
+
+  if (!hist) {
+    invalidate(key);
+    return nullptr;
+  }
+
+  std::error_code error;
+  std::filesystem::last_write_time(
+      filePath, std::filesystem::file_time_type::clock::now(), error);
+
+  return hist;
+}
+
+/**
+ * \brief Store histogram in the cache, through QuickOutSession.
+ *
+ * The file is written under a temporary name and renamed, so concurrent
+ * readers never see a partial file. Size of the cache is tracked, least
+ * recently used entries are removed only when it's over the size limit.
+ *
+ * \param key key of the histogram.
+ * \param hist histogram to be stored.
+ *
+ * \return true if the histogram was stored.
+ */
+bool Throw::HistCache::store(const std::string& key, TH1* hist) {
+  if (key.empty() || !hist) {
+    return false;
+  }
+
+  std::string tmpName = key + "_tmp" + std::to_string(getpid()) + "_" +
+                        RandomString();
+  // Temporary files are skipped by prune, they're removed on every failure
+  QuickOutSession session;
+  bool isWritten = session.write(hist, getFilePath(tmpName), hist->GetName());
+  session.close();
+
+  std::error_code error;
+  if (isWritten) {
+    std::filesystem::rename(getFilePath(tmpName), getFilePath(key), error);
+  }
+  if (!isWritten || error) {
+    std::filesystem::remove(getFilePath(tmpName), error);
+    return false;
+  }
+
+  // Replaced entry is counted twice, the next prune gets the exact size
+  uint64_t entrySize = std::filesystem::file_size(getFilePath(key), error);
+  if (!error) {
+    size += entrySize;
+  }
+  if (size > maxSize) {
+    prune();
+  }
+
+  return true;
+}
+
+/**
+ * \brief Remove histogram from the cache.
+ *
+ * \param key key of the histogram.
+ */
+void Throw::HistCache::invalidate(const std::string& key) {
+  std::error_code error;
+  uint64_t entrySize = std::filesystem::file_size(getFilePath(key), error);
+  if (std::filesystem::remove(getFilePath(key), error)) {
+    size -= std::min(size, entrySize);
+  }
+}
+
+/**
+ * \brief Remove all histograms from the cache.
+ */
+void Throw::HistCache::invalidateAll() {
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(cacheDir, error)) {
+    if (entry.path().extension() == ".root") {
+      std::filesystem::remove(entry.path(), error);
+    }
+  }
+  size = getSize();
+}
+
+/**
+ * \brief Get total size of the cached histograms in bytes.
+ *
+ * Files being stored by other processes are not counted.
+ */
+uint64_t Throw::HistCache::getSize() {
+  uint64_t size = 0;
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(cacheDir, error)) {
+    if (entry.path().extension() == ".root" &&
+        entry.path().filename().string().find("_tmp") == std::string::npos) {
+      size += entry.file_size(error);
+    }
+  }
+
+  return size;
+}
+
+/**
+ * \brief Remove least recently used histograms until the cache fits into the
+ * size limit.
+ *
+ * Scans the cache directory and updates the tracked size.
+ */
+void Throw::HistCache::prune() {
+  std::vector<std::pair<std::filesystem::file_time_type,
+                        std::filesystem::directory_entry>> entryVec;
+  size = 0;
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(cacheDir, error)) {
+    if (entry.path().extension() != ".root") {
+      continue;
+    }
+    // Files being stored by other processes are left alone
+    if (entry.path().filename().string().find("_tmp") != std::string::npos) {
+      continue;
+    }
+    size += entry.file_size(error);
+    entryVec.emplace_back(entry.last_write_time(error), entry);
+  }
+  if (size <= maxSize) {
+    return;
+  }
+
+  std::sort(entryVec.begin(), entryVec.end(),
+            [](const auto& a, const auto& b) {
+              return a.first < b.first;
+            });
+  for (auto &entry : entryVec) {
+    if (size <= maxSize) {
+      break;
+    }
+    uint64_t entrySize = entry.second.file_size(error);
+    if (std::filesystem::remove(entry.second.path(), error)) {
+      size -= entrySize;
+    }
+  }
+}
@@ -6,7 +6,11 @@
 
 // std
 #include <string>
-#include <fstream>
+#include <memory>
+#include <mutex>
+#include <cstdlib>
+// POSIX
+#include <unistd.h>
 // Root
 #include <TFile.h>
 // Throw
@@ -17,40 +21,353 @@
  * \ingroup IO
  * \brief Checks whether file exists.
  *
+ * The file has to be readable, it is not opened.
+ *
  *  \param filePath specifies location of the file.
  */
 bool Throw::FileExists(const std::string& filePath) {
-  if (FILE *file = fopen(filePath.c_str(), "r")) {
-    fclose(file);
-    return true;
-  } else {
-    return false;
+
+  return access(filePath.c_str(), R_OK) == 0;
+}
+
+
+/**
+ * \brief Get column separator of the text dialect.
+ *
+ * \param dialect "TSV" or "CSV".
+ */
+static char GetSeparator(const std::string& dialect) {
+  if (dialect.compare("TSV") == 0) {
+    return '\t';
+  }
+  if (dialect.compare("CSV") == 0) {
+    return ',';
   }
+
+  throw Throw::Exception("Throw::PrintHist, Throw::PrintGraph",
+                         "Unknown text dialect");
 }
 
+/**
+ * \ingroup IO
+ * \brief Prints out histogram values to a tab separated file.
+ *
+ *  \param hist histogram to be printed out.
+ *  \param filePath specifies location of the file.
+ */
+void Throw::PrintHist(TH1* hist, const std::string& filePath) {
+  PrintHist(hist, filePath, "TSV");
+}
 
 /**
  * \ingroup IO
  * \brief Prints out histogram values to a file.
  *
+ * Columns are bin center, bin content, bin width and bin error.
+ *
  *  \param hist histogram to be printed out.
  *  \param filePath specifies location of the file.
+ *  \param dialect "TSV" or "CSV", only TSV starts with the object name.
+ */
+void Throw::PrintHist(TH1* hist,
+                      const std::string& filePath,
+                      const std::string& dialect) {
+  THROW_TRACE("Throw::PrintHist");
+  char sep = GetSeparator(dialect);
+  BufferedWriter outFile(filePath);
+  if (!outFile.isGood()) {
+    throw Exception("Throw::PrintHist", "Can't open output file");
+  }
+
+  if (sep == '\t') {
+    outFile.write(hist->GetName());
+    outFile.write('\n');
+  }
+  outFile.write(std::string("x") + sep + "y" + sep + "x_err" + sep + "y_err\n");
+
+  TAxis* xAxis = hist->GetXaxis();
+  for (int i = 1; i <= xAxis->GetNbins(); ++i) {
+    outFile.write(xAxis->GetBinCenter(i));
+    outFile.write(sep);
+    outFile.write(hist->GetBinContent(i));
+    outFile.write(sep);
+    outFile.write(xAxis->GetBinWidth(i));
+    outFile.write(sep);
+    outFile.write(hist->GetBinError(i));
+    outFile.write('\n');
+  }
+
+  if (!outFile.close()) {
+    throw Exception("Throw::PrintHist", "Write failed");
+  }
+}
+
+/**
+ * \ingroup IO
+ * \brief Prints out 2D histogram values to a tab separated file.
+ *
+ *  \param hist histogram to be printed out.
+ *  \param filePath specifies location of the file.
+ */
+void Throw::PrintHist(TH2* hist, const std::string& filePath) {
+  PrintHist(hist, filePath, "TSV");
+}
+
+/**
+ * \ingroup IO
+ * \brief Prints out 2D histogram values to a file.
+ *
+ * Columns are bin centers, bin content, bin widths and bin error.
+ *
+ *  \param hist histogram to be printed out.
+ *  \param filePath specifies location of the file.
+ *  \param dialect "TSV" or "CSV", only TSV starts with the object name.
+ */
+void Throw::PrintHist(TH2* hist,
+                      const std::string& filePath,
+                      const std::string& dialect) {
+  THROW_TRACE("Throw::PrintHist");
+  char sep = GetSeparator(dialect);
+  BufferedWriter outFile(filePath);
+  if (!outFile.isGood()) {
+    throw Exception("Throw::PrintHist", "Can't open output file");
+  }
+
+  if (sep == '\t') {
+    outFile.write(hist->GetName());
+    outFile.write('\n');
+  }
+  outFile.write(std::string("x") + sep + "y" + sep + "z" + sep +
+                "x_err" + sep + "y_err" + sep + "z_err\n");
+
+  TAxis* xAxis = hist->GetXaxis();
+  TAxis* yAxis = hist->GetYaxis();
+  for (int j = 1; j <= yAxis->GetNbins(); ++j) {
+    for (int i = 1; i <= xAxis->GetNbins(); ++i) {
+      outFile.write(xAxis->GetBinCenter(i));
+      outFile.write(sep);
+      outFile.write(yAxis->GetBinCenter(j));
+      outFile.write(sep);
+      outFile.write(hist->GetBinContent(i, j));
+      outFile.write(sep);
+      outFile.write(xAxis->GetBinWidth(i));
+      outFile.write(sep);
+      outFile.write(yAxis->GetBinWidth(j));
+      outFile.write(sep);
+      outFile.write(hist->GetBinError(i, j));
+      outFile.write('\n');
+    }
+  }
+
+  if (!outFile.close()) {
+    throw Exception("Throw::PrintHist", "Write failed");
+  }
+}
+
+/**
+ * \ingroup IO
+ * \brief Prints out graph points to a tab separated file.
+ *
+ *  \param graph graph to be printed out.
+ *  \param filePath specifies location of the file.
+ */
+void Throw::PrintGraph(TGraph* graph, const std::string& filePath) {
+  PrintGraph(graph, filePath, "TSV");
+}
+
+/**
+ * \ingroup IO
+ * \brief Prints out graph points to a file.
+ *
+ * Columns are point coordinates followed by low and high errors, errors are
+ * zero for graphs without them.
+ *
+ *  \param graph graph to be printed out.
+ *  \param filePath specifies location of the file.
+ *  \param dialect "TSV" or "CSV", only TSV starts with the object name.
+ */
+void Throw::PrintGraph(TGraph* graph,
+                       const std::string& filePath,
+                       const std::string& dialect) {
+  THROW_TRACE("Throw::PrintGraph");
+  char sep = GetSeparator(dialect);
+  BufferedWriter outFile(filePath);
+  if (!outFile.isGood()) {
+    throw Exception("Throw::PrintGraph", "Can't open output file");
+  }
+
+  if (sep == '\t') {
+    outFile.write(graph->GetName());
+    outFile.write('\n');
+  }
+  outFile.write(std::string("x") + sep + "y" + sep +
+                "x_err_low" + sep + "x_err_high" + sep +
+                "y_err_low" + sep + "y_err_high\n");
+
+  double* x = graph->GetX();
+  double* y = graph->GetY();
+  double* exl = graph->GetEXlow() ? graph->GetEXlow() : graph->GetEX();
+  double* exh = graph->GetEXhigh() ? graph->GetEXhigh() : graph->GetEX();
+  double* eyl = graph->GetEYlow() ? graph->GetEYlow() : graph->GetEY();
+  double* eyh = graph->GetEYhigh() ? graph->GetEYhigh() : graph->GetEY();
+  for (int i = 0; i < graph->GetN(); ++i) {
+    outFile.write(x[i]);
+    outFile.write(sep);
+    outFile.write(y[i]);
+    outFile.write(sep);
+    outFile.write(exl ? exl[i] : 0.);
+    outFile.write(sep);
+    outFile.write(exh ? exh[i] : 0.);
+    outFile.write(sep);
+    outFile.write(eyl ? eyl[i] : 0.);
+    outFile.write(sep);
+    outFile.write(eyh ? eyh[i] : 0.);
+    outFile.write('\n');
+  }
+
+  if (!outFile.close()) {
+    throw Exception("Throw::PrintGraph", "Write failed");
+  }
+}
+
+/**
+ * \ingroup IO
+ * \brief Prints out 2D graph points to a tab separated file.
+ *
+ *  \param graph graph to be printed out.
+ *  \param filePath specifies location of the file.
+ */
+void Throw::PrintGraph(TGraph2D* graph, const std::string& filePath) {
+  PrintGraph(graph, filePath, "TSV");
+}
+
+/**
+ * \ingroup IO
+ * \brief Prints out 2D graph points to a file.
+ *
+ * Columns are point coordinates followed by their errors, errors are zero for
+ * graphs without them.
+ *
+ *  \param graph graph to be printed out.
+ *  \param filePath specifies location of the file.
+ *  \param dialect "TSV" or "CSV", only TSV starts with the object name.
+ */
+void Throw::PrintGraph(TGraph2D* graph,
+                       const std::string& filePath,
+                       const std::string& dialect) {
+  THROW_TRACE("Throw::PrintGraph");
+  char sep = GetSeparator(dialect);
+  BufferedWriter outFile(filePath);
+  if (!outFile.isGood()) {
+    throw Exception("Throw::PrintGraph", "Can't open output file");
+  }
+
+  if (sep == '\t') {
+    outFile.write(graph->GetName());
+    outFile.write('\n');
+  }
+  outFile.write(std::string("x") + sep + "y" + sep + "z" + sep +
+                "x_err" + sep + "y_err" + sep + "z_err\n");
+
+  double* x = graph->GetX();
+  double* y = graph->GetY();
+  double* z = graph->GetZ();
+  double* ex = graph->GetEX();
+  double* ey = graph->GetEY();
+  double* ez = graph->GetEZ();
+  for (int i = 0; i < graph->GetN(); ++i) {
+    outFile.write(x[i]);
+    outFile.write(sep);
+    outFile.write(y[i]);
+    outFile.write(sep);
+    outFile.write(z[i]);
+    outFile.write(sep);
+    outFile.write(ex ? ex[i] : 0.);
+    outFile.write(sep);
+    outFile.write(ey ? ey[i] : 0.);
+    outFile.write(sep);
+    outFile.write(ez ? ez[i] : 0.);
+    outFile.write('\n');
+  }
+
+  if (!outFile.close()) {
+    throw Exception("Throw::PrintGraph", "Write failed");
+  }
+}
+
+/**
+ * \ingroup IO
+ * \brief Get root compression settings of the compression profile.
+ *
+ * \param profile one of "none", "fast" (LZ4), "balanced" (ZSTD level 5),
+ * "archive" (ZSTD level 9), "default" (ROOT default) or explicit algorithm
+ * and level, e.g. "LZMA:7". Known algorithms are ZLIB, LZMA, LZ4 and ZSTD.
+ *
+ * Returns -1 for the ROOT default.
  */
-void Throw::PrintHist(TH1D* hist, const std::string& filePath) {
-  std::ofstream outFile;
-  outFile.open(filePath);
+int Throw::GetCompressionSettings(const std::string& profile) {
+  if (profile.empty() || profile.compare("default") == 0) {
+    return -1;
+  }
+  if (profile.compare("none") == 0) {
+    return 0;
+  }
+  if (profile.compare("fast") == 0) {
+    return 404;
+  }
+  if (profile.compare("balanced") == 0) {
+    return 505;
+  }
+  if (profile.compare("archive") == 0) {
+    return 509;
+  }
 
-  outFile << hist->GetName() << std::endl;
-  outFile << "x\ty\tx_err\ty_err" << std::endl;
+  std::vector<std::string> tokens = SplitString(profile, ':');
+  if (tokens.size() != 2 || tokens.at(1).size() != 1 ||
+      tokens.at(1).at(0) < '0' || tokens.at(1).at(0) > '9') {
+    throw Exception("Throw::GetCompressionSettings",
+                    "Unknown compression profile");
+  }
+  int level = tokens.at(1).at(0) - '0';
 
-  for (int i = 1; i <= hist->GetXaxis()->GetNbins(); ++i) {
-    outFile << hist->GetBinCenter(i) << "\t";
-    outFile << hist->GetBinContent(i) << "\t";
-    outFile << hist->GetBinWidth(i) << "\t";
-    outFile << hist->GetBinError(i) << std::endl;
+  if (tokens.at(0).compare("ZLIB") == 0) {
+    return 100 + level;
+  }
+  if (tokens.at(0).compare("LZMA") == 0) {
+    return 200 + level;
+  }
+  if (tokens.at(0).compare("LZ4") == 0) {
+    return 400 + level;
+  }
+  if (tokens.at(0).compare("ZSTD") == 0) {
+    return 500 + level;
   }
 
-  return;
+  throw Exception("Throw::GetCompressionSettings",
+                  "Unknown compression algorithm");
+}
+
+/**
+ * \brief Get root file path used by QuickOut.
+ *
+ * \param path root file path without root file name.
+ * \param name object name.
+ */
+static std::string QuickOutFilePath(TObject* object,
+                                    const std::string& path,
+                                    const std::string& name) {
+  std::string objectPath = object->GetName();
+  objectPath = "./" + objectPath;
+  if (!path.empty()) {
+    objectPath = path;
+  }
+
+  std::string objectName = object->GetName();
+  if (!name.empty()) {
+    objectName = name;
+  }
+
+  return objectPath + "/" + objectName + ".root";
 }
 
 /**
@@ -88,26 +405,127 @@ void Throw::QuickOut(TObject* object, const std::string& path) {
 void Throw::QuickOut(TObject* object,
                      const std::string& path,
                      const std::string& name) {
-  std::string objectPath = object->GetName();
-  objectPath = "./" + objectPath;
-  if (!path.empty()) {
-    objectPath = path;
+  QuickOut(object, path, name, "default");
+}
+
+/**
+ * \ingroup IO
+ * \brief Quickly output an object to a compressed root file.
+ *
+ * \param path root file path without root file name.
+ * \param name object name.
+ * \param profile compression profile, see Throw::GetCompressionSettings.
+ *
+ * The name of the file will inherited from the object name.
+ */
+void Throw::QuickOut(TObject* object,
+                     const std::string& path,
+                     const std::string& name,
+                     const std::string& profile) {
+  THROW_TRACE("Throw::QuickOut");
+  QuickOutSession session(profile);
+  session.write(object, QuickOutFilePath(object, path, name), name);
+}
+
+/**
+ * \brief Guards the writer shared by Throw::QuickOutAsync.
+ */
+static std::mutex sharedWriterMutex;
+
+/**
+ * \brief Writer shared by Throw::QuickOutAsync.
+ *
+ * It's not a static object, joining the I/O thread during the static
+ * destruction would race with the teardown of ROOT. It's shut down by a
+ * handler registered with std::atexit when the writer is first started,
+ * which runs before ROOT, initialized earlier, is torn down.
+ */
+static std::shared_ptr<Throw::AsyncWriter>& SharedWriter() {
+  static auto* writer = new std::shared_ptr<Throw::AsyncWriter>();
+
+  return *writer;
+}
+
+/**
+ * \ingroup IO
+ * \brief Output an object to a root file on a background I/O thread.
+ *
+ * The root file will be created in the location of the executable and root file
+ * name will be inherited from the name of the object.
+ *
+ * \param object object to be written, ownership is taken. Pass a clone to keep
+ * using the object.
+ */
+std::future<bool> Throw::QuickOutAsync(TObject* object) {
+
+  return QuickOutAsync(object, "", "");
+}
+
+/**
+ * \ingroup IO
+ * \brief Output an object to a root file on a background I/O thread.
+ *
+ * \param object object to be written, ownership is taken.
+ * \param path root file path without root file name.
+ */
+std::future<bool> Throw::QuickOutAsync(TObject* object,
+                                       const std::string& path) {
+
+  return QuickOutAsync(object, path, "");
+}
+
+/**
+ * \ingroup IO
+ * \brief Output an object to a root file on a background I/O thread.
+ *
+ * \param object object to be written, ownership is taken.
+ * \param path root file path without root file name.
+ * \param name object name.
+ *
+ * The objects are written by a shared writer, which is started on the first
+ * call. It's stopped by Throw::ShutdownQuickOutAsync or at the normal end of
+ * the program, queued objects are written and the files are closed. The
+ * returned future becomes ready once the object is flushed to the file.
+ */
+std::future<bool> Throw::QuickOutAsync(TObject* object,
+                                       const std::string& path,
+                                       const std::string& name) {
+  if (!object) {
+    throw Exception("Throw::QuickOutAsync", "Null TObject* provided");
   }
 
-  std::string objectName = object->GetName();
-  if (!name.empty()) {
-    objectName = name;
+  std::shared_ptr<AsyncWriter> writer;
+  {
+    std::lock_guard<std::mutex> lock(sharedWriterMutex);
+    if (!SharedWriter()) {
+      static bool isRegistered = false;
+      if (!isRegistered) {
+        std::atexit(ShutdownQuickOutAsync);
+        isRegistered = true;
+      }
+      SharedWriter() = std::make_shared<AsyncWriter>();
+    }
+    writer = SharedWriter();
   }
 
-  system(("mkdir -p " + objectPath).c_str());
+  return writer->write(object, QuickOutFilePath(object, path, name), name);
+}
 
-  TFile* outFile = new TFile((objectPath + "/" + objectName + ".root").c_str(),
-                             "RECREATE");
-  if (outFile->IsOpen()) {
-    object->Write(objectName.c_str());
-    outFile->Write();
-    outFile->Close();
+/**
+ * \ingroup IO
+ * \brief Write all objects queued by Throw::QuickOutAsync and stop its writer.
+ *
+ * Called automatically at the normal end of the program. Later calls of
+ * Throw::QuickOutAsync start a new writer, which recreates the files.
+ */
+void Throw::ShutdownQuickOutAsync() {
+  std::shared_ptr<AsyncWriter> writer;
+  {
+    std::lock_guard<std::mutex> lock(sharedWriterMutex);
+    writer.swap(SharedWriter());
   }
 
-  delete outFile;
+  if (writer) {
+    writer->shutdown();
+  }
 }
@@ -0,0 +1,281 @@
+/**
+ * \file ThrowInputDiscovery.cxx
+ * \brief Implementation of the input discovery and sharding.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <atomic>
+#include <mutex>
+#include <thread>
+// POSIX
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Every file costs at least this many bytes when balancing shards.
+ */
+static const uint64_t kFileCost = 4096;
+
+/**
+ * \brief Cached files are stated again after this time.
+ */
+static const std::chrono::seconds kCacheLifetime(10);
+
+/**
+ * \brief Stated input file with the time it was stated.
+ */
+struct CacheEntry {
+  Throw::InputFile input;
+  std::chrono::steady_clock::time_point statTime;
+};
+
+/**
+ * \brief Cache of already stated input files.
+ */
+static std::mutex cacheMutex;
+static std::unordered_map<std::string, CacheEntry> inputCache;
+
+/**
+ * \brief Expand input argument into paths.
+ *
+ * Glob patterns are expanded, directories are searched recursively for
+ * regular files. Everything else is taken as a path.
+ *
+ * \param arg input argument.
+ * \param paths output paths.
+ */
+static void ExpandInput(const std::string& arg,
+                        std::vector<std::string>& paths) {
+  std::vector<std::string> candidates;
+  if (arg.find_first_of("*?[") != std::string::npos) {
+    glob_t globResult;
+    if (glob(arg.c_str(), 0, nullptr, &globResult) == 0) {
+      for (size_t i = 0; i < globResult.gl_pathc; ++i) {
+        candidates.emplace_back(globResult.gl_pathv[i]);
+      }
+    } else {
+      THROW_LOG_WARNING("Throw::DiscoverInputs -- Nothing matches: " + arg);
+    }
+    globfree(&globResult);
+  } else {
+    candidates.emplace_back(arg);
+  }
+
+  for (auto &candidate : candidates) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(candidate, error)) {
+      paths.emplace_back(candidate);
+      continue;
+    }
+
+    // Unreadable entries stop the search of the directory, not the program
+    std::vector<std::string> dirPaths;
+    std::filesystem::recursive_directory_iterator itr(
+        candidate,
+        std::filesystem::directory_options::skip_permission_denied,
+        error);
+    std::filesystem::recursive_directory_iterator end;
+    while (!error && itr != end) {
+      std::error_code entryError;
+      if (itr->is_regular_file(entryError)) {
+        dirPaths.emplace_back(itr->path().string());
+      }
+      itr.increment(error);
+    }
+    if (error) {
+      THROW_LOG_WARNING("Throw::DiscoverInputs -- Can't search directory " +
+                        candidate + ": " + error.message());
+    }
+    std::sort(dirPaths.begin(), dirPaths.end());
+    paths.insert(paths.end(), dirPaths.begin(), dirPaths.end());
+  }
+}
+
+/**
+ * \ingroup IO
+ * \brief Expand input arguments and get sizes of the files.
+ *
+ * Uses one thread per hardware core.
+ *
+ * \param args files, directories or glob patterns.
+ */
+std::vector<Throw::InputFile> Throw::DiscoverInputs(
+    const std::vector<std::string>& args) {
+
+  return DiscoverInputs(args, std::thread::hardware_concurrency());
+}
+
+/**
+ * \ingroup IO
+ * \brief Expand input arguments and get sizes of the files.
+ *
+ * Glob patterns are expanded and directories are searched recursively. The
+ * files are stated in parallel and the results are cached, files cached for
+ * more than 10 seconds are stated again, see ClearInputCache(). Duplicate
+ * paths are removed, missing files are skipped with a warning.
+ *
+ * \param args files, directories or glob patterns.
+ * \param nThreads number of threads.
+ */
+std::vector<Throw::InputFile> Throw::DiscoverInputs(
+    const std::vector<std::string>& args, size_t nThreads) {
+  std::vector<std::string> paths;
+  for (const auto &arg : args) {
+    ExpandInput(arg, paths);
+  }
+
+  std::unordered_set<std::string> seen;
+  std::vector<InputFile> inputs;
+  std::vector<size_t> toStat;
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (auto &path : paths) {
+      if (!seen.insert(path).second) {
+        continue;
+      }
+      auto itr = inputCache.find(path);
+      if (itr != inputCache.end() &&
+          now - itr->second.statTime < kCacheLifetime) {
+        inputs.emplace_back(itr->second.input);
+      } else {
+        toStat.emplace_back(inputs.size());
+        inputs.push_back({path, 0, -1});
+      }
+    }
+  }
+
+  if (nThreads < 1) {
+    nThreads = 1;
+  }
+  if (nThreads > toStat.size()) {
+    nThreads = toStat.size();
+  }
+
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < toStat.size(); i = next++) {
+      InputFile& input = inputs[toStat[i]];
+      struct statx fileStat;
+      if (statx(AT_FDCWD, input.path.c_str(), 0,
+                STATX_TYPE | STATX_SIZE | STATX_MTIME, &fileStat) != 0 ||
+          !S_ISREG(fileStat.stx_mode)) {
+        continue;
+      }
+      input.size = fileStat.stx_size;
+      input.mtime = fileStat.stx_mtime.tv_sec;
+    }
+  };
+
+  std::vector<std::thread> threadVec;
+  for (size_t i = 0; i < nThreads; ++i) {
+    threadVec.emplace_back(worker);
+  }
+  for (auto &thread : threadVec) {
+    thread.join();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (size_t i : toStat) {
+      if (inputs[i].mtime < 0) {
+        inputCache.erase(inputs[i].path);
+      } else {
+        inputCache[inputs[i].path] = {inputs[i], now};
+      }
+    }
+  }
+
+  std::vector<InputFile> found;
+  found.reserve(inputs.size());
+  for (auto &input : inputs) {
+    if (input.mtime < 0) {
+      THROW_LOG_WARNING("Throw::DiscoverInputs -- Can't find file: " +
+                        input.path);
+      continue;
+    }
+    found.emplace_back(input);
+  }
+
+  return found;
+}
+
+/**
+ * \ingroup IO
+ * \brief Forget sizes of the already discovered files.
+ */
+void Throw::ClearInputCache() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  inputCache.clear();
+}
+
+/**
+ * \ingroup IO
+ * \brief Split inputs into shards of about the same size in bytes.
+ *
+ * Largest files are assigned first, always to the lightest shard. The result
+ * depends only on the inputs, so independent processes get the same shards.
+ * Files keep their input order inside of the shard.
+ *
+ * \param inputs discovered input files.
+ * \param nShards number of shards.
+ */
+std::vector<std::vector<Throw::InputFile>> Throw::MakeShards(
+    const std::vector<InputFile>& inputs, size_t nShards) {
+  if (nShards < 1) {
+    throw Exception("Throw::MakeShards", "Number of shards has to be positive");
+  }
+
+  std::vector<size_t> order(inputs.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return inputs[a].size > inputs[b].size;
+  });
+
+  std::vector<uint64_t> shardSize(nShards, 0);
+  std::vector<size_t> assignment(inputs.size());
+  for (size_t i : order) {
+    size_t lightest = std::min_element(shardSize.begin(), shardSize.end()) -
+                      shardSize.begin();
+    shardSize[lightest] += inputs[i].size + kFileCost;
+    assignment[i] = lightest;
+  }
+
+  std::vector<std::vector<InputFile>> shards(nShards);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    shards[assignment[i]].emplace_back(inputs[i]);
+  }
+
+  return shards;
+}
+
+/**
+ * \ingroup IO
+ * \brief Get one of the shards of the inputs.
+ *
+ * \param inputs discovered input files.
+ * \param nShards number of shards.
+ * \param shardIndex index of the shard, e.g. index of the batch job.
+ */
+std::vector<Throw::InputFile> Throw::MakeShard(
+    const std::vector<InputFile>& inputs, size_t nShards, size_t shardIndex) {
+  if (shardIndex >= nShards) {
+    throw Exception("Throw::MakeShard", "Shard index out of range");
+  }
+
+  return MakeShards(inputs, nShards).at(shardIndex);
+}
@@ -6,43 +6,230 @@
 
 // std
 #include <string>
+#include <string_view>
 #include <vector>
+#include <unordered_map>
+#include <charconv>
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 // Throw
 #include "Throw.h"
 
 
+/**
+ * \brief Parse whole string as a number.
+ *
+ * \param str string to be parsed.
+ * \param value output value.
+ *
+ * \return true if the whole string is a valid number.
+ */
+template<typename T>
+static bool ParseNumber(const std::string& str, T& value) {
+  T result;
+  const char* last = str.data() + str.size();
+  auto [ptr, ec] = std::from_chars(str.data(), last, result);
+  if (ec != std::errc() || ptr != last) {
+    return false;
+  }
+  value = result;
+
+  return true;
+}
+
 /**
  * \brief Default constructor of InputParser.
  * \param argc number of program parameters.
  * \param argv array of program parameters.
  */
 Throw::InputParser::InputParser (int& argc, char** argv) {
+  tokens.reserve(argc);
   for (size_t i = 1; i < argc; ++i) {
-    this->tokens.emplace_back(std::string(argv[i]));
+    std::string_view token(argv[i]);
+    if (token.size() > 1 && token[0] == '@' &&
+        readResponseFile(std::string(token.substr(1)))) {
+      continue;
+    }
+    addToken(token);
+  }
+
+  tokenIndex.reserve(tokens.size());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    // Only the first occurrence is kept
+    tokenIndex.emplace(tokens[i], i);
   }
 }
 
+/**
+ * \brief Add token, split "--opt=value" into option and value.
+ * \param token program parameter.
+ */
+void Throw::InputParser::addToken(std::string_view token) {
+  size_t pos = token.find('=');
+  if (token.size() > 1 && token[0] == '-' && pos != std::string_view::npos &&
+      pos > 1) {
+    tokens.emplace_back(token.substr(0, pos));
+    tokens.emplace_back(token.substr(pos + 1));
+    return;
+  }
+
+  tokens.emplace_back(token);
+}
+
+/**
+ * \brief Add whitespace separated tokens from the response file.
+ * \param filePath path to the response file.
+ *
+ * \return false if the file can't be read.
+ */
+bool Throw::InputParser::readResponseFile(const std::string& filePath) {
+  int fd = open(filePath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    THROW_LOG_WARNING("Throw::InputParser -- Can't open response file: " +
+                      filePath);
+    return false;
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0) {
+    close(fd);
+    return false;
+  }
+  if (fileStat.st_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  size_t fileSize = fileStat.st_size;
+  void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    THROW_LOG_WARNING("Throw::InputParser -- Can't map response file: " +
+                      filePath);
+    return false;
+  }
+  madvise(mapping, fileSize, MADV_SEQUENTIAL);
+
+  std::string_view content(static_cast<const char*>(mapping), fileSize);
+  for (std::string_view token : SplitView(content, " \t\r\n")) {
+    if (!token.empty()) {
+      addToken(token);
+    }
+  }
+
+  munmap(mapping, fileSize);
+
+  return true;
+}
+
 /**
  * \brief Get parameter value.
  * \param option parameter name.
  */
 const std::string& Throw::InputParser::getCmdOption(
     const std::string& option) const {
-  std::vector<std::string>::const_iterator itr;
-  itr =  find(this->tokens.begin(), this->tokens.end(), option);
-  if (itr != this->tokens.end() && ++itr != this->tokens.end()) {
-    return *itr;
+  auto itr = tokenIndex.find(option);
+  if (itr != tokenIndex.end() && itr->second + 1 < tokens.size()) {
+    return tokens[itr->second + 1];
   }
   static const std::string empty_string;
 
   return empty_string;
 }
 
+/**
+ * \brief Get parameter value as integer.
+ * \param option parameter name.
+ * \param value output value, untouched if the parameter is missing.
+ *
+ * \return true if the parameter exists.
+ */
+bool Throw::InputParser::getCmdOption(const std::string& option,
+                                      int& value) const {
+  if (!cmdOptionExists(option)) {
+    return false;
+  }
+  if (!ParseNumber(getCmdOption(option), value)) {
+    throw Exception("Throw::InputParser::getCmdOption", "Value is not integer");
+  }
+
+  return true;
+}
+
+/**
+ * \brief Get parameter value as integer.
+ * \param option parameter name.
+ * \param value output value, untouched if the parameter is missing.
+ *
+ * \return true if the parameter exists.
+ */
+bool Throw::InputParser::getCmdOption(const std::string& option,
+                                      long long& value) const {
+  if (!cmdOptionExists(option)) {
+    return false;
+  }
+  if (!ParseNumber(getCmdOption(option), value)) {
+    throw Exception("Throw::InputParser::getCmdOption", "Value is not integer");
+  }
+
+  return true;
+}
+
+/**
+ * \brief Get parameter value as unsigned integer.
+ * \param option parameter name.
+ * \param value output value, untouched if the parameter is missing.
+ *
+ * \return true if the parameter exists.
+ */
+bool Throw::InputParser::getCmdOption(const std::string& option,
+                                      size_t& value) const {
+  if (!cmdOptionExists(option)) {
+    return false;
+  }
+  if (!ParseNumber(getCmdOption(option), value)) {
+    throw Exception("Throw::InputParser::getCmdOption",
+                    "Value is not unsigned integer");
+  }
+
+  return true;
+}
+
+/**
+ * \brief Get parameter value as floating point number.
+ * \param option parameter name.
+ * \param value output value, untouched if the parameter is missing.
+ *
+ * \return true if the parameter exists.
+ */
+bool Throw::InputParser::getCmdOption(const std::string& option,
+                                      double& value) const {
+  if (!cmdOptionExists(option)) {
+    return false;
+  }
+  if (!ParseNumber(getCmdOption(option), value)) {
+    throw Exception("Throw::InputParser::getCmdOption", "Value is not number");
+  }
+
+  return true;
+}
+
 /**
  * \brief Test whether the parameter exists.
  * \param option parameter name.
  */
 bool Throw::InputParser::cmdOptionExists(const std::string& option) const {
-    return find(this->tokens.begin(), this->tokens.end(), option)
-           != this->tokens.end();
+
+  return tokenIndex.find(option) != tokenIndex.end();
+}
+
+/**
+ * \brief Get all tokens, with response files expanded.
+ */
+const std::vector<std::string>& Throw::InputParser::getTokens() const {
+
+  return tokens;
 }
@@ -0,0 +1,368 @@
+/**
+ * \file ThrowLogger.cxx
+ * \brief Implementation of the asynchronous logger.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <cstdio>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Maximal length of the message, longer messages are truncated.
+ */
+static const size_t kTextSize = 240;
+
+/**
+ * \brief Number of messages buffered per thread.
+ */
+static const size_t kRingSize = 256;
+
+/**
+ * \brief Time between two flushes of the buffers.
+ */
+static const std::chrono::milliseconds kFlushInterval(100);
+
+/**
+ * \brief Logged message.
+ */
+struct LogRecord {
+  Throw::LogLevel level;
+  int64_t time;
+  uint64_t nSuppressed;
+  size_t length;
+  char text[kTextSize];
+};
+
+/**
+ * \brief Buffer of messages of one thread.
+ *
+ * Written only by the thread, read only by the flushing thread. Buffer of an
+ * exited thread is released once it's drained.
+ */
+struct LogRing {
+  LogRecord records[kRingSize];
+  std::atomic<uint64_t> head;
+  std::atomic<uint64_t> tail;
+  std::atomic<uint64_t> nDropped;
+  std::atomic<bool> retired;
+};
+
+/**
+ * \brief Runtime level and rate limit.
+ */
+static std::atomic<int> logLevel(Throw::kLogInfo);
+static std::atomic<uint64_t> logRateLimit(10);
+
+/**
+ * \brief Buffers of all threads and the flushing thread.
+ */
+class LoggerState {
+  public:
+    std::mutex ringMutex;
+    std::vector<std::shared_ptr<LogRing>> ringVec;
+
+    LoggerState() {
+      stopping = false;
+      flushThread = std::thread(&LoggerState::run, this);
+    }
+
+    ~LoggerState() {
+      {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+      }
+      wakeUp.notify_one();
+      flushThread.join();
+      drain();
+    }
+
+    void notify() {
+      wakeUp.notify_one();
+    }
+
+    void drain();
+  private:
+    bool stopping;
+    std::mutex wakeMutex;
+    std::condition_variable wakeUp;
+    std::mutex drainMutex;
+    std::thread flushThread;
+
+    void run() {
+      std::unique_lock<std::mutex> lock(wakeMutex);
+      while (!stopping) {
+        wakeUp.wait_for(lock, kFlushInterval);
+        lock.unlock();
+        drain();
+        lock.lock();
+      }
+    }
+};
+
+/**
+ * \brief Get the logger state, starts the flushing thread at the first call.
+ */
+static LoggerState& GetLoggerState() {
+  static LoggerState state;
+
+  return state;
+}
+
+/**
+ * \brief Holds buffer of the current thread, retires it when the thread
+ * exits.
+ */
+struct LogRingOwner {
+  LogRing* ring = nullptr;
+
+  ~LogRingOwner() {
+    if (ring) {
+      ring->retired.store(true, std::memory_order_release);
+      GetLoggerState().notify();
+    }
+  }
+};
+
+/**
+ * \brief Get buffer of the current thread, registers the thread at the first
+ * call.
+ */
+static LogRing& GetThreadRing() {
+  thread_local LogRingOwner owner;
+  if (!owner.ring) {
+    auto ring = std::make_shared<LogRing>();
+    ring->head.store(0);
+    ring->tail.store(0);
+    ring->nDropped.store(0);
+    ring->retired.store(false);
+
+    LoggerState& state = GetLoggerState();
+    std::lock_guard<std::mutex> lock(state.ringMutex);
+    state.ringVec.emplace_back(ring);
+    owner.ring = ring.get();
+  }
+
+  return *owner.ring;
+}
+
+/**
+ * \brief Get name of the level as printed in the log.
+ */
+static const char* GetLevelName(Throw::LogLevel level) {
+  switch (level) {
+    case Throw::kLogDebug:
+      return "DEBUG";
+    case Throw::kLogInfo:
+      return "INFO";
+    case Throw::kLogWarning:
+      return "WARNING";
+    case Throw::kLogError:
+      return "ERROR";
+  }
+
+  return "";
+}
+
+/**
+ * \brief Write buffered messages of all threads ordered by time.
+ */
+void LoggerState::drain() {
+  std::lock_guard<std::mutex> drainLock(drainMutex);
+
+  std::vector<LogRecord> batch;
+  uint64_t nDropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    for (auto itr = ringVec.begin(); itr != ringVec.end();) {
+      LogRing& ring = **itr;
+      // Retired before reading the head, so the last messages are included
+      bool retired = ring.retired.load(std::memory_order_acquire);
+      uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+      uint64_t head = ring.head.load(std::memory_order_acquire);
+      for (uint64_t i = tail; i < head; ++i) {
+        batch.emplace_back(ring.records[i % kRingSize]);
+      }
+      ring.tail.store(head, std::memory_order_release);
+      nDropped += ring.nDropped.exchange(0, std::memory_order_relaxed);
+
+      if (retired) {
+        itr = ringVec.erase(itr);
+      } else {
+        ++itr;
+      }
+    }
+  }
+  if (batch.empty() && nDropped == 0) {
+    return;
+  }
+
+  std::stable_sort(batch.begin(), batch.end(),
+                   [](const LogRecord& a, const LogRecord& b) {
+                     return a.time < b.time;
+                   });
+
+  std::string out;
+  char line[64];
+  for (auto &record : batch) {
+    Throw::FormatTime(record.time / 1000000000, line, sizeof(line));
+    out += line;
+    out += ' ';
+    out += GetLevelName(record.level);
+    out += ": ";
+    out.append(record.text, record.length);
+    if (record.nSuppressed > 0) {
+      snprintf(line, sizeof(line), " (%llu similar messages suppressed)",
+               (unsigned long long) record.nSuppressed);
+      out += line;
+    }
+    out += '\n';
+  }
+  if (nDropped > 0) {
+    Throw::FormatTime(time(nullptr), line, sizeof(line));
+    out += line;
+    snprintf(line, sizeof(line),
+             " WARNING: Throw::Logger -- %llu messages dropped!\n",
+             (unsigned long long) nDropped);
+    out += line;
+  }
+
+  fwrite(out.data(), 1, out.size(), stderr);
+  fflush(stderr);
+}
+
+/**
+ * \brief Constructor of LogSite.
+ */
+Throw::LogSite::LogSite() {
+  window.store(0);
+  nInWindow.store(0);
+  nSuppressed.store(0);
+}
+
+/**
+ * \brief Check the rate limit of the site.
+ *
+ * \return false if the site logged too many messages in the current second.
+ */
+bool Throw::LogSite::allow() {
+  uint64_t limit = Logger::getRateLimit();
+  if (limit == 0) {
+    return true;
+  }
+
+  int64_t now = time(nullptr);
+  if (window.load(std::memory_order_relaxed) != now) {
+    window.store(now, std::memory_order_relaxed);
+    nInWindow.store(0, std::memory_order_relaxed);
+  }
+  if (nInWindow.fetch_add(1, std::memory_order_relaxed) < limit) {
+    return true;
+  }
+  nSuppressed.fetch_add(1, std::memory_order_relaxed);
+
+  return false;
+}
+
+/**
+ * \brief Get number of messages suppressed since the last call.
+ */
+uint64_t Throw::LogSite::takeSuppressed() {
+
+  return nSuppressed.exchange(0, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Set minimal level of logged messages, default is kLogInfo.
+ */
+void Throw::Logger::setLevel(LogLevel level) {
+  logLevel.store(level, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Get minimal level of logged messages.
+ */
+Throw::LogLevel Throw::Logger::getLevel() {
+
+  return static_cast<LogLevel>(logLevel.load(std::memory_order_relaxed));
+}
+
+/**
+ * \brief Returns true if messages of the level are logged.
+ */
+bool Throw::Logger::isEnabled(LogLevel level) {
+
+  return level >= logLevel.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Set maximal number of messages per second from one call site.
+ *
+ * \param limit number of messages, 0 disables the limit. Default is 10.
+ */
+void Throw::Logger::setRateLimit(uint64_t limit) {
+  logRateLimit.store(limit, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Get maximal number of messages per second from one call site.
+ */
+uint64_t Throw::Logger::getRateLimit() {
+
+  return logRateLimit.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Add message to the buffer of the current thread.
+ *
+ * Use THROW_LOG instead, it skips building of filtered messages.
+ *
+ * \param level level of the message.
+ * \param site call site.
+ * \param message message, longer messages are truncated.
+ */
+void Throw::Logger::log(LogLevel level,
+                        LogSite& site,
+                        const std::string& message) {
+  LogRing& ring = GetThreadRing();
+  uint64_t head = ring.head.load(std::memory_order_relaxed);
+  uint64_t tail = ring.tail.load(std::memory_order_acquire);
+  if (head - tail >= kRingSize) {
+    ring.nDropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  LogRecord& record = ring.records[head % kRingSize];
+  record.level = level;
+  record.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  record.nSuppressed = site.takeSuppressed();
+  record.length = std::min(message.size(), kTextSize);
+  memcpy(record.text, message.data(), record.length);
+  ring.head.store(head + 1, std::memory_order_release);
+
+  // Errors are written right away, a filling buffer is drained early
+  if (level >= kLogError || head - tail >= kRingSize / 2) {
+    GetLoggerState().notify();
+  }
+}
+
+/**
+ * \brief Write all buffered messages now.
+ */
+void Throw::Logger::flush() {
+  GetLoggerState().drain();
+}
@@ -0,0 +1,334 @@
+/**
+ * \file ThrowMerge.cxx
+ * \brief Implementation of the parallel merging of root files.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <set>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+// Root
+#include <TROOT.h>
+#include <TClass.h>
+#include <TFile.h>
+#include <TKey.h>
+#include <TList.h>
+#include <TH1.h>
+#include <TGraph.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Add the source object to the target object.
+ *
+ * Histograms are added bin by bin, graph points are appended.
+ */
+static bool MergeInto(TObject* target, TObject* source) {
+  if (TH1* hist = dynamic_cast<TH1*>(target)) {
+    TH1* sourceHist = dynamic_cast<TH1*>(source);
+    return sourceHist && hist->Add(sourceHist);
+  }
+
+  if (TGraph* graph = dynamic_cast<TGraph*>(target)) {
+    TList sourceList;
+    sourceList.Add(source);
+    return graph->Merge(&sourceList) >= 0;
+  }
+
+  return false;
+}
+
+/**
+ * \brief Number of object names merged in one pass over the input files.
+ *
+ * Every thread holds at most this many partial sums at a time.
+ */
+static const size_t kKeysPerPass = 16;
+
+/**
+ * \brief Check that the key holds a histogram or a graph.
+ */
+static bool IsMergeable(TKey* key) {
+  TClass* keyClass = TClass::GetClass(key->GetClassName());
+
+  return keyClass &&
+         (keyClass->InheritsFrom("TH1") || keyClass->InheritsFrom("TGraph"));
+}
+
+/**
+ * \brief Read names of the top level histograms and graphs of the file.
+ *
+ * \param inputPath root file to be read.
+ * \param keys names of the objects in the order of the file.
+ */
+static bool ReadKeys(const std::string& inputPath,
+                     std::vector<std::string>& keys) {
+  TDirectory::TContext context;
+  TFile* inFile = TFile::Open(inputPath.c_str(), "READ");
+  if (!inFile || inFile->IsZombie()) {
+    delete inFile;
+    return false;
+  }
+
+  std::set<std::string> seen;
+  TIter next(inFile->GetListOfKeys());
+  while (TKey* key = dynamic_cast<TKey*>(next())) {
+    if (IsMergeable(key) && seen.insert(key->GetName()).second) {
+      keys.emplace_back(key->GetName());
+    }
+  }
+
+  inFile->Close();
+  delete inFile;
+
+  return true;
+}
+
+/**
+ * \brief Read the objects of the file and add them to the partial sums of
+ * the thread.
+ *
+ * Newest cycle of every object is read, the file is closed before returning.
+ *
+ * \param inputPath root file to be read.
+ * \param keyNames names of the read objects.
+ * \param partials partial sums of the thread, one per name.
+ * \param success set to false if an object can't be merged.
+ */
+static bool ReadObjects(const std::string& inputPath,
+                        const std::vector<std::string>& keyNames,
+                        std::vector<TObject*>& partials,
+                        std::atomic<bool>& success) {
+  TDirectory::TContext context;
+  TFile* inFile = TFile::Open(inputPath.c_str(), "READ");
+  if (!inFile || inFile->IsZombie()) {
+    delete inFile;
+    return false;
+  }
+
+  for (size_t i = 0; i < keyNames.size(); ++i) {
+    TKey* key = inFile->GetKey(keyNames.at(i).c_str());
+    if (!key || !IsMergeable(key)) {
+      continue;
+    }
+    TObject* object = key->ReadObj();
+    if (!object) {
+      continue;
+    }
+    if (TH1* hist = dynamic_cast<TH1*>(object)) {
+      hist->SetDirectory(nullptr);
+    }
+
+    if (!partials.at(i)) {
+      partials.at(i) = object;
+    } else {
+      if (!MergeInto(partials.at(i), object)) {
+        success = false;
+      }
+      delete object;
+    }
+  }
+
+  inFile->Close();
+  delete inFile;
+
+  return true;
+}
+
+/**
+ * \brief Barrier of the merging threads.
+ */
+class MergeBarrier {
+  public:
+    explicit MergeBarrier(size_t nThreads) {
+      this->nThreads = nThreads;
+      nArrived = 0;
+      generation = 0;
+    }
+
+    /**
+     * \brief Wait for all threads, the last one to arrive runs the task
+     * before the others are released.
+     */
+    void wait(const std::function<void()>& last) {
+      std::unique_lock<std::mutex> lock(mutex);
+      size_t arrivedGeneration = generation;
+      if (++nArrived == nThreads) {
+        last();
+        nArrived = 0;
+        ++generation;
+        released.notify_all();
+      } else {
+        released.wait(lock, [&] { return generation != arrivedGeneration; });
+      }
+    }
+
+  private:
+    std::mutex mutex;
+    std::condition_variable released;
+    size_t nThreads;
+    size_t nArrived;
+    size_t generation;
+};
+
+/**
+ * \ingroup IO
+ * \brief Merge histograms and graphs from many root files into one.
+ *
+ * Uses one thread per hardware core.
+ *
+ * \param inputPaths root files to be merged.
+ * \param outputPath merged root file.
+ */
+bool Throw::MergeFiles(const std::vector<std::string>& inputPaths,
+                       const std::string& outputPath) {
+
+  return MergeFiles(inputPaths, outputPath,
+                    std::thread::hardware_concurrency());
+}
+
+/**
+ * \ingroup IO
+ * \brief Merge histograms and graphs from many root files into one.
+ *
+ * Top level TH1, TH2 and TGraph objects with the same name are merged, other
+ * objects are skipped. One pool of threads is used for the whole merge. The
+ * object names are merged in passes of 16: the threads read the names of the
+ * pass from their share of the input files, opened one at a time, and sum
+ * them. The per-thread partial sums are then merged pairwise in a parallel
+ * reduction tree and written through QuickOutSession in the order of the
+ * input files before the next pass, only the names of one pass are held in
+ * memory.
+ *
+ * \param inputPaths root files to be merged.
+ * \param outputPath merged root file.
+ * \param nThreads number of threads.
+ */
+bool Throw::MergeFiles(const std::vector<std::string>& inputPaths,
+                       const std::string& outputPath,
+                       size_t nThreads) {
+  if (inputPaths.empty()) {
+    return false;
+  }
+
+  ROOT::EnableThreadSafety();
+  if (nThreads < 1) {
+    nThreads = 1;
+  }
+  if (nThreads > inputPaths.size()) {
+    nThreads = inputPaths.size();
+  }
+
+  std::atomic<bool> success(true);
+  std::vector<std::vector<std::string>> fileKeys(inputPaths.size());
+  std::vector<char> isOpened(inputPaths.size(), 0);
+  std::vector<std::string> keyNames;
+  std::vector<std::string> passNames;
+  std::vector<std::vector<TObject*>> partials(nThreads);
+  QuickOutSession session;
+
+  MergeBarrier barrier(nThreads);
+  std::atomic<size_t> next(0);
+  auto worker = [&](size_t t) {
+    for (size_t i = next++; i < inputPaths.size(); i = next++) {
+      if (ReadKeys(inputPaths.at(i), fileKeys.at(i))) {
+        isOpened.at(i) = 1;
+      } else {
+        THROW_LOG_WARNING("Throw::MergeFiles -- Can't open file: " +
+                          inputPaths.at(i));
+        success = false;
+      }
+    }
+    barrier.wait([&] {
+      std::set<std::string> seenKeys;
+      for (auto &keys : fileKeys) {
+        for (auto &key : keys) {
+          if (seenKeys.insert(key).second) {
+            keyNames.emplace_back(key);
+          }
+        }
+      }
+      next = 0;
+    });
+
+    for (size_t passBegin = 0; passBegin < keyNames.size();
+         passBegin += kKeysPerPass) {
+      barrier.wait([&] {
+        size_t passEnd = std::min(passBegin + kKeysPerPass, keyNames.size());
+        passNames.assign(keyNames.begin() + passBegin,
+                         keyNames.begin() + passEnd);
+        for (auto &threadPartials : partials) {
+          threadPartials.assign(passNames.size(), nullptr);
+        }
+      });
+
+      for (size_t i = next++; i < inputPaths.size(); i = next++) {
+        if (isOpened.at(i) &&
+            !ReadObjects(inputPaths.at(i), passNames, partials.at(t),
+                         success)) {
+          THROW_LOG_WARNING("Throw::MergeFiles -- Can't open file: " +
+                            inputPaths.at(i));
+          success = false;
+        }
+      }
+      barrier.wait([&] { next = 0; });
+
+      // Level of the tree merges thread pairs (target, target + stride)
+      for (size_t stride = 1; stride < nThreads; stride *= 2) {
+        size_t nPairs = (nThreads + 2 * stride - 1) / (2 * stride);
+        size_t nTasks = nPairs * passNames.size();
+        for (size_t task = next++; task < nTasks; task = next++) {
+          size_t k = task % passNames.size();
+          size_t target = 2 * stride * (task / passNames.size());
+          size_t source = target + stride;
+          if (source >= nThreads || !partials.at(source).at(k)) {
+            continue;
+          }
+          if (!partials.at(target).at(k)) {
+            std::swap(partials.at(target).at(k), partials.at(source).at(k));
+            continue;
+          }
+          if (!MergeInto(partials.at(target).at(k),
+                         partials.at(source).at(k))) {
+            success = false;
+          }
+          delete partials.at(source).at(k);
+          partials.at(source).at(k) = nullptr;
+        }
+        barrier.wait([&] { next = 0; });
+      }
+
+      barrier.wait([&] {
+        for (size_t k = 0; k < passNames.size(); ++k) {
+          TObject* merged = partials.front().at(k);
+          if (!merged) {
+            continue;
+          }
+          if (!session.write(merged, outputPath, passNames.at(k))) {
+            success = false;
+          }
+          delete merged;
+        }
+      });
+    }
+  };
+
+  std::vector<std::thread> threadVec;
+  for (size_t i = 0; i < nThreads; ++i) {
+    threadVec.emplace_back(worker, i);
+  }
+  for (auto &thread : threadVec) {
+    thread.join();
+  }
+  session.close();
+
+  return success;
+}
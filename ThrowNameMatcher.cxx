@@ -0,0 +1,344 @@
+/**
+ * \file ThrowNameMatcher.cxx
+ * \brief Implementation of NameMatcher.
+ */
+
+
+// std
+#include <string>
+#include <string_view>
+#include <vector>
+#include <bitset>
+#include <regex>
+#include <algorithm>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Read one, possibly escaped, member of a glob character class.
+ *
+ * \param glob glob pattern.
+ * \param pos position of the member, moved past it.
+ */
+static unsigned char ClassMember(const std::string& glob, size_t& pos) {
+  if (glob[pos] == '\\' && pos + 1 < glob.size()) {
+    ++pos;
+  }
+
+  return glob[pos++];
+}
+
+/**
+ * \brief Buffers of the glob automaton.
+ */
+struct MatchBuffers {
+  std::vector<size_t> active;
+  std::vector<size_t> next;
+  std::vector<bool> isActive;
+  std::vector<bool> isNext;
+  std::vector<bool> isMatched;
+};
+
+/**
+ * \brief Buffers reused by all matches on the thread, their capacity only
+ * grows.
+ */
+static thread_local MatchBuffers matchBuffers;
+
+/**
+ * \brief Default constructor of NameMatcher, no pattern matches.
+ */
+Throw::NameMatcher::NameMatcher() {
+  nPatterns = 0;
+}
+
+/**
+ * \brief Constructor of NameMatcher from glob patterns.
+ *
+ * \param globs glob patterns, their indices are the positions in the vector.
+ */
+Throw::NameMatcher::NameMatcher(const std::vector<std::string>& globs) {
+  nPatterns = 0;
+  for (const auto &glob : globs) {
+    addGlob(glob);
+  }
+}
+
+/**
+ * \brief Add glob pattern.
+ *
+ * Supports "*", "?", "[abc]", "[a-z]", "[!abc]" and "\" escapes. As with
+ * fnmatch without flags, "*" matches also "/".
+ *
+ * \param glob glob pattern.
+ *
+ * \return index of the pattern.
+ */
+size_t Throw::NameMatcher::addGlob(const std::string& glob) {
+  size_t patternIndex = nPatterns++;
+
+  if (glob.find_first_of("*?[\\") == std::string::npos) {
+    literalStore.emplace_back(glob);
+    literalMap[literalStore.back()].emplace_back(patternIndex);
+
+    return patternIndex;
+  }
+
+  size_t start = stateVec.size();
+  for (size_t i = 0; i < glob.size(); ++i) {
+    State state = {kLiteral, (unsigned char) glob[i], patternIndex, false};
+    if (glob[i] == '*') {
+      if (stateVec.size() > start && stateVec.back().type == kStar) {
+        continue;
+      }
+      state.type = kStar;
+    } else if (glob[i] == '?') {
+      state.type = kAnyChar;
+    } else if (glob[i] == '\\' && i + 1 < glob.size()) {
+      state.symbol = glob[++i];
+    } else if (glob[i] == '[') {
+      size_t j = i + 1;
+      bool negate = false;
+      if (j < glob.size() && (glob[j] == '!' || glob[j] == '^')) {
+        negate = true;
+        ++j;
+      }
+      std::bitset<256> charClass;
+      bool closed = false;
+      // Closing bracket right after the opening one is a member
+      for (size_t k = j; k < glob.size();) {
+        if (glob[k] == ']' && k > j) {
+          closed = true;
+          j = k;
+          break;
+        }
+        unsigned char first = ClassMember(glob, k);
+        unsigned char last = first;
+        if (k + 1 < glob.size() && glob[k] == '-' && glob[k + 1] != ']') {
+          ++k;
+          last = ClassMember(glob, k);
+        }
+        for (unsigned c = first; c <= last; ++c) {
+          charClass.set(c);
+        }
+      }
+      if (closed) {
+        if (negate) {
+          charClass.flip();
+        }
+        state.type = kCharClass;
+        state.index = charClassVec.size();
+        charClassVec.emplace_back(charClass);
+        i = j;
+      }
+    }
+    stateVec.emplace_back(state);
+  }
+  stateVec.push_back({kAccept, 0, patternIndex, false});
+
+  // Once the trailing stars are reached, the rest of the name doesn't matter
+  for (size_t i = stateVec.size() - 1; i-- > start;) {
+    if (stateVec.at(i).type != kStar) {
+      break;
+    }
+    stateVec.at(i).anySuffix = true;
+  }
+  startVec.emplace_back(start);
+
+  return patternIndex;
+}
+
+/**
+ * \brief Add regular expression pattern (ECMAScript), which has to match the
+ * whole name.
+ *
+ * \param regex regular expression.
+ *
+ * \return index of the pattern.
+ */
+size_t Throw::NameMatcher::addRegex(const std::string& regex) {
+  size_t patternIndex = nPatterns++;
+  regexVec.emplace_back(patternIndex,
+                        std::regex(regex, std::regex::ECMAScript |
+                                          std::regex::optimize));
+
+  return patternIndex;
+}
+
+/**
+ * \brief Get number of patterns.
+ */
+size_t Throw::NameMatcher::getNpatterns() const {
+
+  return nPatterns;
+}
+
+/**
+ * \brief Returns true if any of the patterns matches the name.
+ *
+ * \param name name to be matched.
+ */
+bool Throw::NameMatcher::matches(std::string_view name) const {
+  if (literalMap.find(name) != literalMap.end()) {
+    return true;
+  }
+  if (matchGlobs(name, nullptr)) {
+    return true;
+  }
+  for (const auto &regex : regexVec) {
+    if (std::regex_match(name.begin(), name.end(), regex.second)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * \brief Get indices of all patterns matching the name.
+ *
+ * \param name name to be matched.
+ */
+std::vector<size_t> Throw::NameMatcher::match(std::string_view name) const {
+  std::vector<size_t> patternIndices;
+  match(name, patternIndices);
+
+  return patternIndices;
+}
+
+/**
+ * \brief Get indices of all patterns matching the name.
+ *
+ * \param name name to be matched.
+ * \param patternIndices output, sorted indices of the matching patterns.
+ */
+void Throw::NameMatcher::match(std::string_view name,
+                               std::vector<size_t>& patternIndices) const {
+  patternIndices.clear();
+
+  auto literal = literalMap.find(name);
+  if (literal != literalMap.end()) {
+    patternIndices.insert(patternIndices.end(),
+                          literal->second.begin(), literal->second.end());
+  }
+  matchGlobs(name, &patternIndices);
+  for (const auto &regex : regexVec) {
+    if (std::regex_match(name.begin(), name.end(), regex.second)) {
+      patternIndices.emplace_back(regex.first);
+    }
+  }
+
+  std::sort(patternIndices.begin(), patternIndices.end());
+}
+
+/**
+ * \brief Activate the state and the states reachable from it without
+ * consuming a character.
+ */
+void Throw::NameMatcher::addState(size_t state,
+                                  std::vector<size_t>& active,
+                                  std::vector<bool>& isActive) const {
+  while (!isActive[state]) {
+    isActive[state] = true;
+    active.emplace_back(state);
+    // Star can match empty string
+    if (stateVec[state].type != kStar) {
+      break;
+    }
+    ++state;
+  }
+}
+
+/**
+ * \brief Run all glob patterns over the name at once.
+ *
+ * State buffers are reused by the following calls on the same thread, so
+ * matching doesn't allocate once they are large enough.
+ *
+ * \param name name to be matched.
+ * \param patternIndices output for the matching patterns, if null the
+ * matching stops at the first match.
+ *
+ * \return true if any glob pattern matches.
+ */
+bool Throw::NameMatcher::matchGlobs(
+    std::string_view name, std::vector<size_t>* patternIndices) const {
+  if (startVec.empty()) {
+    return false;
+  }
+
+  std::vector<size_t>& active = matchBuffers.active;
+  std::vector<size_t>& next = matchBuffers.next;
+  std::vector<bool>& isActive = matchBuffers.isActive;
+  std::vector<bool>& isNext = matchBuffers.isNext;
+  std::vector<bool>& isMatched = matchBuffers.isMatched;
+  active.clear();
+  next.clear();
+  isActive.assign(stateVec.size(), false);
+  isNext.assign(stateVec.size(), false);
+  isMatched.assign(nPatterns, false);
+  bool matched = false;
+
+  auto accept = [&](size_t patternIndex) {
+    matched = true;
+    if (patternIndices && !isMatched[patternIndex]) {
+      isMatched[patternIndex] = true;
+      patternIndices->emplace_back(patternIndex);
+    }
+  };
+
+  for (size_t start : startVec) {
+    addState(start, active, isActive);
+  }
+
+  for (size_t i = 0; i < name.size() && !active.empty(); ++i) {
+    unsigned char symbol = name[i];
+    for (size_t state : active) {
+      const State& current = stateVec[state];
+      if (current.anySuffix) {
+        accept(current.index);
+        if (!patternIndices) {
+          return true;
+        }
+        continue;
+      }
+
+      switch (current.type) {
+        case kLiteral:
+          if (current.symbol == symbol) {
+            addState(state + 1, next, isNext);
+          }
+          break;
+        case kAnyChar:
+          addState(state + 1, next, isNext);
+          break;
+        case kCharClass:
+          if (charClassVec[current.index].test(symbol)) {
+            addState(state + 1, next, isNext);
+          }
+          break;
+        case kStar:
+          addState(state, next, isNext);
+          break;
+        case kAccept:
+          break;
+      }
+    }
+
+    for (size_t state : active) {
+      isActive[state] = false;
+    }
+    active.swap(next);
+    isActive.swap(isNext);
+    next.clear();
+  }
+
+  for (size_t state : active) {
+    if (stateVec[state].type == kAccept || stateVec[state].anySuffix) {
+      accept(stateVec[state].index);
+    }
+  }
+
+  return matched;
+}
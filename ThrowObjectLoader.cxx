@@ -0,0 +1,222 @@
+/**
+ * \file ThrowObjectLoader.cxx
+ * \brief Implementation of the parallel object loader.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <exception>
+// Root
+#include <TROOT.h>
+#include <TClass.h>
+#include <TFile.h>
+#include <TKey.h>
+#include <TH1.h>
+#include <TGraph2D.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Read objects matching the patterns from the directory and its
+ * subdirectories.
+ *
+ * \param dir directory to read from.
+ * \param prefix path of the directory inside of the file.
+ * \param matcher patterns matched against object paths.
+ * \param objects read objects, keyed by their path.
+ */
+static void ReadDirectory(
+    TDirectory* dir,
+    const std::string& prefix,
+    const Throw::NameMatcher& matcher,
+    std::vector<std::pair<std::string, TObject*>>& objects) {
+  std::set<std::string> seen;
+  TIter next(dir->GetListOfKeys());
+  while (TKey* key = dynamic_cast<TKey*>(next())) {
+    std::string name = prefix + key->GetName();
+    // Keys are sorted by cycle, only the newest one is read
+    if (!seen.insert(name).second) {
+      continue;
+    }
+
+    TClass* keyClass = TClass::GetClass(key->GetClassName());
+    if (!keyClass) {
+      continue;
+    }
+    if (keyClass->InheritsFrom(TDirectory::Class())) {
+      TDirectory* subDir = dir->GetDirectory(key->GetName());
+      if (subDir) {
+        ReadDirectory(subDir, name + "/", matcher, objects);
+      }
+      continue;
+    }
+    if (keyClass->InheritsFrom("TTree")) {
+      continue;
+    }
+
+    if (!matcher.matches(name)) {
+      continue;
+    }
+
+    TObject* object = key->ReadObj();
+    if (!object) {
+      continue;
+    }
+    if (TH1* hist = dynamic_cast<TH1*>(object)) {
+      hist->SetDirectory(nullptr);
+    }
+    if (TGraph2D* graph = dynamic_cast<TGraph2D*>(object)) {
+      graph->SetDirectory(nullptr);
+    }
+    objects.emplace_back(name, object);
+  }
+}
+
+/**
+ * \ingroup IO
+ * \brief Load objects from many root files in parallel.
+ *
+ * Uses one thread per hardware core.
+ *
+ * \param filePaths root files to load from.
+ * \param patterns glob patterns matched against object paths inside of the
+ * files, e.g. "hist_*" or "dir/h*".
+ */
+std::map<std::string, std::vector<TObject*>> Throw::LoadObjects(
+    const std::vector<std::string>& filePaths,
+    const std::vector<std::string>& patterns) {
+
+  return LoadObjects(filePaths, NameMatcher(patterns),
+                     std::thread::hardware_concurrency());
+}
+
+/**
+ * \ingroup IO
+ * \brief Load objects from many root files in parallel.
+ *
+ * \param filePaths root files to load from.
+ * \param patterns glob patterns matched against object paths inside of the
+ * files, e.g. "hist_*" or "dir/h*".
+ * \param nThreads number of threads.
+ */
+std::map<std::string, std::vector<TObject*>> Throw::LoadObjects(
+    const std::vector<std::string>& filePaths,
+    const std::vector<std::string>& patterns,
+    size_t nThreads) {
+
+  return LoadObjects(filePaths, NameMatcher(patterns), nThreads);
+}
+
+/**
+ * \ingroup IO
+ * \brief Load objects from many root files in parallel.
+ *
+ * Uses one thread per hardware core.
+ *
+ * \param filePaths root files to load from.
+ * \param matcher patterns matched against object paths inside of the files.
+ */
+std::map<std::string, std::vector<TObject*>> Throw::LoadObjects(
+    const std::vector<std::string>& filePaths,
+    const NameMatcher& matcher) {
+
+  return LoadObjects(filePaths, matcher, std::thread::hardware_concurrency());
+}
+
+/**
+ * \ingroup IO
+ * \brief Load objects from many root files in parallel.
+ *
+ * Every thread opens its own files. Objects are detached from the files,
+ * grouped by their path and ordered as the input files. The caller owns the
+ * objects. Files which can't be opened are skipped with a warning. Exception
+ * thrown while reading stops the loading, the loaded objects are deleted and
+ * the exception is rethrown to the caller.
+ *
+ * \param filePaths root files to load from.
+ * \param matcher patterns matched against object paths inside of the files.
+ * \param nThreads number of threads.
+ */
+std::map<std::string, std::vector<TObject*>> Throw::LoadObjects(
+    const std::vector<std::string>& filePaths,
+    const NameMatcher& matcher,
+    size_t nThreads) {
+  ROOT::EnableThreadSafety();
+
+  if (nThreads < 1) {
+    nThreads = 1;
+  }
+  if (nThreads > filePaths.size()) {
+    nThreads = filePaths.size();
+  }
+
+  std::vector<std::vector<std::pair<std::string, TObject*>>> fileObjects(
+      filePaths.size());
+  std::atomic<size_t> nextFile(0);
+  std::mutex errorMutex;
+  std::exception_ptr error;
+  auto worker = [&]() {
+    TFile* inFile = nullptr;
+    try {
+      for (size_t i = nextFile++; i < filePaths.size(); i = nextFile++) {
+        TDirectory::TContext context;
+        inFile = TFile::Open(filePaths.at(i).c_str(), "READ");
+        if (!inFile || inFile->IsZombie()) {
+          THROW_LOG_WARNING("Throw::LoadObjects -- Can't open file: " +
+                            filePaths.at(i));
+          delete inFile;
+          inFile = nullptr;
+          continue;
+        }
+
+        ReadDirectory(inFile, "", matcher, fileObjects.at(i));
+
+        inFile->Close();
+        delete inFile;
+        inFile = nullptr;
+      }
+    } catch (...) {
+      // First error is rethrown by the calling thread, the others stop
+      delete inFile;
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      nextFile = filePaths.size();
+    }
+  };
+
+  std::vector<std::thread> threadVec;
+  for (size_t i = 0; i < nThreads; ++i) {
+    threadVec.emplace_back(worker);
+  }
+  for (auto &thread : threadVec) {
+    thread.join();
+  }
+
+  if (error) {
+    for (auto &objects : fileObjects) {
+      for (auto &object : objects) {
+        delete object.second;
+      }
+    }
+    std::rethrow_exception(error);
+  }
+
+  std::map<std::string, std::vector<TObject*>> objectMap;
+  for (auto &objects : fileObjects) {
+    for (auto &object : objects) {
+      objectMap[object.first].emplace_back(object.second);
+    }
+  }
+
+  return objectMap;
+}
@@ -7,10 +7,13 @@
 // std
 #include <string>
 #include <vector>
+#include <cmath>
 // Root
 #include <TH1.h>
 #include <TStyle.h>
 #include <TCanvas.h>
+#include <TPad.h>
+#include <TImage.h>
 #include <TLegend.h>
 #include <TPaveText.h>
 #include <TGraphAsymmErrors.h>
@@ -65,6 +68,9 @@ Throw::Plotter::Plotter(const std::string& filePath) {
   tickLength = 0.03;
 
   outFilePath = filePath;
+
+  rasterize = false;
+  rasterDpi = 300;
 }
 
 /**
@@ -202,29 +208,31 @@ double Throw::Plotter::getYoffset() {
 /**
  * \brief Get label on x-axis.
  */
-std::string Throw::Plotter::getXlabel() {
-  return xLabel;
+const std::string& Throw::Plotter::getXlabel() {
+
+  return xLabel.str();
 }
 
 /**
  * \brief Get label on y-axis.
  */
-std::string Throw::Plotter::getYlabel() {
-  return yLabel;
+const std::string& Throw::Plotter::getYlabel() {
+
+  return yLabel.str();
 }
 
 /**
  * \brief Set label on x-axis.
  */
 void Throw::Plotter::setXlabel(const std::string& param) {
-  xLabel = param;
+  xLabel = InternedString(param);
 }
 
 /**
  * \brief Set label on y-axis.
  */
 void Throw::Plotter::setYlabel(const std::string& param) {
-  yLabel = param;
+  yLabel = InternedString(param);
 }
 
 /**
@@ -276,25 +284,25 @@ void Throw::Plotter::setYoffset(double val) {
 /**
  * \brief Get drawing parameter of histogram at index.
  */
-std::string Throw::Plotter::getHistDrawParam(int index) {
+const std::string& Throw::Plotter::getHistDrawParam(int index) {
 
-  return histDrawParamsVec.at(index);
+  return histDrawParamsVec.at(index).str();
 }
 
 /**
  * \brief Get drawing parameter of graph at index.
  */
-std::string Throw::Plotter::getGraphDrawParam(int index) {
+const std::string& Throw::Plotter::getGraphDrawParam(int index) {
 
-  return graphDrawParamsVec.at(index);
+  return graphDrawParamsVec.at(index).str();
 }
 
 /**
  * \brief Get drawing parameter of function at index.
  */
-std::string Throw::Plotter::getFuncDrawParam(int index) {
+const std::string& Throw::Plotter::getFuncDrawParam(int index) {
 
-  return funcDrawParamsVec.at(index);
+  return funcDrawParamsVec.at(index).str();
 }
 
 /**
@@ -302,7 +310,7 @@ std::string Throw::Plotter::getFuncDrawParam(int index) {
  */
 void Throw::Plotter::setHistDrawParam(int index,
                                           const std::string& param) {
-  histDrawParamsVec.at(index) = param;
+  histDrawParamsVec.at(index) = InternedString(param);
 }
 
 /**
@@ -310,7 +318,7 @@ void Throw::Plotter::setHistDrawParam(int index,
  */
 void Throw::Plotter::setGraphDrawParam(int index,
                                            const std::string& param) {
-  graphDrawParamsVec.at(index) = param;
+  graphDrawParamsVec.at(index) = InternedString(param);
 }
 
 /**
@@ -318,7 +326,7 @@ void Throw::Plotter::setGraphDrawParam(int index,
  */
 void Throw::Plotter::setFuncDrawParam(int index,
                                           const std::string& param) {
-  funcDrawParamsVec.at(index) = param;
+  funcDrawParamsVec.at(index) = InternedString(param);
 }
 
 /**
@@ -349,7 +357,7 @@ void Throw::Plotter::addFuncDrawParam(const std::string& param) {
  */
 void Throw::Plotter::addLine(TLine* line) {
   if (!line) {
-    throw "ERROR: Throw::Plotter::addLine -- Null TLine* provided!";
+    throw Exception("Throw::Plotter::addLine", "Null TLine* provided");
   }
 
   lineVec.emplace_back(line);
@@ -360,7 +368,7 @@ void Throw::Plotter::addLine(TLine* line) {
  */
 void Throw::Plotter::addLabel(TPaveText* label) {
   if (!label) {
-    throw "ERROR: Throw::Plotter::addLabel -- Null TPaveText* provided!";
+    throw Exception("Throw::Plotter::addLabel", "Null TPaveText* provided");
   }
 
   labelVec.emplace_back(label);
@@ -370,7 +378,7 @@ void Throw::Plotter::addLabel(TPaveText* label) {
 /**
  * Get plot output file path.
  */
-std::string Throw::Plotter::getOutFilePath() {
+const std::string& Throw::Plotter::getOutFilePath() {
 
   return outFilePath;
 }
@@ -381,3 +389,150 @@ std::string Throw::Plotter::getOutFilePath() {
 void Throw::Plotter::setOutFilePath(const std::string& filePath) {
   outFilePath = filePath;
 }
+
+/**
+ * \brief Set whether the data layer will be rasterized.
+ *
+ * Axes, legend, notes, lines and labels stay vector graphics.
+ */
+void Throw::Plotter::setRasterize(bool val) {
+  rasterize = val;
+}
+
+/**
+ * \brief Returns whether the data layer will be rasterized.
+ */
+bool Throw::Plotter::getRasterize() {
+
+  return rasterize;
+}
+
+/**
+ * \brief Set resolution of the rasterized data layer in dots per inch.
+ */
+void Throw::Plotter::setRasterDpi(int val) {
+  if (val < 1) {
+    throw Exception("Throw::Plotter::setRasterDpi",
+                    "Non-positive DPI provided");
+  }
+
+  rasterDpi = val;
+}
+
+/**
+ * \brief Get resolution of the rasterized data layer in dots per inch.
+ */
+int Throw::Plotter::getRasterDpi() {
+
+  return rasterDpi;
+}
+
+/**
+ * \brief Replace objects drawn on the canvas with their raster image.
+ *
+ * The canvas is cloned into an off-screen canvas scaled to the raster
+ * resolution, axis labels and ticks are hidden there and the result is
+ * embedded back into the canvas as an image. Axes are redrawn on top of it in
+ * a transparent pad, which is left as the current pad, so everything drawn
+ * afterwards stays vector graphics.
+ *
+ * \param canvas canvas with the data layer already drawn.
+ */
+void Throw::Plotter::rasterizeDataLayer(TCanvas* canvas) {
+  THROW_TRACE("Throw::Plotter::rasterizeDataLayer");
+  canvas->cd();
+  canvas->Update();
+
+  double xLow = canvas->GetUxmin();
+  double xUp = canvas->GetUxmax();
+  double yLow = canvas->GetUymin();
+  double yUp = canvas->GetUymax();
+  if (canvas->GetLogx()) {
+    xLow = std::pow(10., xLow);
+    xUp = std::pow(10., xUp);
+  }
+  if (canvas->GetLogy()) {
+    yLow = std::pow(10., yLow);
+    yUp = std::pow(10., yUp);
+  }
+
+  double scale = getRasterDpi() / 72.;
+  TCanvas* rasterCanvas = new TCanvas("rasterCanvas", "Raster canvas",
+                                      scale * canvas->GetWw(),
+                                      scale * canvas->GetWh());
+  rasterCanvas->cd();
+  canvas->DrawClonePad();
+
+  auto hideAxis = [](TAxis* axis) {
+    axis->SetLabelSize(0);
+    axis->SetTitleSize(0);
+    axis->SetTickLength(0);
+  };
+  TIter next(rasterCanvas->GetListOfPrimitives());
+  while (TObject* obj = next()) {
+    TH1* axisHist = dynamic_cast<TH1*>(obj);
+    if (TGraph* graph = dynamic_cast<TGraph*>(obj)) {
+      axisHist = graph->GetHistogram();
+    }
+    if (TGraph2D* graph = dynamic_cast<TGraph2D*>(obj)) {
+      axisHist = graph->GetHistogram();
+    }
+    if (TF1* func = dynamic_cast<TF1*>(obj)) {
+      axisHist = func->GetHistogram();
+    }
+    if (axisHist) {
+      hideAxis(axisHist->GetXaxis());
+      hideAxis(axisHist->GetYaxis());
+    }
+
+    if (TAttLine* line = dynamic_cast<TAttLine*>(obj)) {
+      line->SetLineWidth(scale * line->GetLineWidth());
+    }
+    if (TAttMarker* marker = dynamic_cast<TAttMarker*>(obj)) {
+      marker->SetMarkerSize(scale * marker->GetMarkerSize());
+    }
+  }
+  rasterCanvas->Update();
+
+  TImage* dataImage = TImage::Create();
+  dataImage->FromPad(rasterCanvas);
+  delete rasterCanvas;
+
+  canvas->Clear();
+  canvas->cd();
+
+  TPad* imagePad = new TPad("imagePad", "Raster data layer", 0., 0., 1., 1.);
+  imagePad->SetMargin(0., 0., 0., 0.);
+  imagePad->SetBit(kCanDelete);
+  imagePad->Draw();
+  imagePad->cd();
+  dataImage->SetBit(kCanDelete);
+  dataImage->Draw();
+
+  canvas->cd();
+  TPad* vectorPad = new TPad("vectorPad", "Vector layer", 0., 0., 1., 1.);
+  vectorPad->SetFillStyle(4000);
+  vectorPad->SetFrameFillStyle(4000);
+  vectorPad->SetMargin(canvas->GetLeftMargin(), canvas->GetRightMargin(),
+                       canvas->GetBottomMargin(), canvas->GetTopMargin());
+  vectorPad->SetLogx(getLogX());
+  vectorPad->SetLogy(getLogY());
+  vectorPad->SetBit(kCanDelete);
+  vectorPad->Draw();
+  vectorPad->cd();
+
+  TH1F* frame = vectorPad->DrawFrame(xLow, yLow, xUp, yUp);
+  frame->GetXaxis()->SetLabelFont(43);
+  frame->GetXaxis()->SetLabelSize(12);
+  frame->GetXaxis()->SetTitleFont(43);
+  frame->GetXaxis()->SetTitleSize(12);
+  frame->GetXaxis()->SetTitleOffset(getXoffset());
+  frame->GetXaxis()->SetTitle(getXlabel().c_str());
+
+  frame->GetYaxis()->SetLabelFont(43);
+  frame->GetYaxis()->SetLabelSize(12);
+  frame->GetYaxis()->SetTitleFont(43);
+  frame->GetYaxis()->SetTitleSize(12);
+  frame->GetYaxis()->SetTitleOffset(getYoffset());
+  frame->GetYaxis()->SetTitle(getYlabel().c_str());
+}
@@ -85,7 +85,7 @@ void Throw::Plotter1D::rotateGraphsMarkers(int diff = 0) {
  */
 void Throw::Plotter1D::addHist(TH1D* inHist) {
   if (!inHist) {
-    throw "ERROR: Empty histogram added!";
+    throw Exception("Throw::Plotter1D::addHist", "Empty histogram added");
   }
 
   std::string histName = inHist->GetName();
@@ -135,7 +135,7 @@ void Throw::Plotter1D::addHist(TH1D* inHist) {
  */
 void Throw::Plotter1D::addGraph(TGraph* inGraph) {
   if (!inGraph) {
-    throw "ERROR: Empty graph added!";
+    throw Exception("Throw::Plotter1D::addGraph", "Empty graph added");
   }
 
   TGraphAsymmErrors* graph = new TGraphAsymmErrors(inGraph->GetN());
@@ -165,7 +165,7 @@ void Throw::Plotter1D::addGraph(TGraph* inGraph) {
  */
 void Throw::Plotter1D::addGraph(TGraphAsymmErrors* inGraph) {
   if (!inGraph) {
-    throw "ERROR: Empty graph added!";
+    throw Exception("Throw::Plotter1D::addGraph", "Empty graph added");
   }
 
   std::string graphName = inGraph->GetName();
@@ -209,6 +209,23 @@ void Throw::Plotter1D::addGraph(TGraphAsymmErrors* inGraph) {
   addGraphDrawParam("E1P");
 }
 
+/**
+ * \brief Add graph pyramid to the list of pyramids.
+ *
+ * The graph is taken from the pyramid level matching the x-window and the
+ * canvas width every time the plot is drawn. The pyramid is not owned by the
+ * plotter and has to outlive it.
+ *
+ * \param pyramid pyramid to be added.
+ */
+void Throw::Plotter1D::addPyramid(GraphPyramid* pyramid) {
+  if (!pyramid) {
+    throw Exception("Throw::Plotter1D::addPyramid", "Empty pyramid added");
+  }
+
+  pyramidVec.emplace_back(pyramid);
+}
+
 /**
  * \brief Get pointer to histogram at index.
  * \param index index of the histogram
@@ -237,6 +254,7 @@ TGraphAsymmErrors* Throw::Plotter1D::getGraph(int index) {
  * \brief Plot drawing function.
  */
 void Throw::Plotter1D::draw() {
+  THROW_TRACE("Throw::Plotter1D::draw");
   TCanvas *canvas = new TCanvas("canvas", "Canvas", 350, 350);
   gPad->SetTopMargin(.05);
   gPad->SetLeftMargin(.10);
@@ -272,30 +290,71 @@ void Throw::Plotter1D::draw() {
     legend = new TLegend();
   }
 
+  // Pyramid windows are drawn like the graphs, but they live only during the
+  // draw, so the plot can be drawn again with another x-window
+  double yMin = getYmin();
+  double yMax = getYmax();
+  bool hasRange = nObj() > 0;
+  std::vector<TGraphAsymmErrors*> drawGraphVec = graphVec;
+  int nPixels = canvas->GetWw() *
+                (1. - gPad->GetLeftMargin() - gPad->GetRightMargin());
+  for (auto &pyramid : pyramidVec) {
+    TGraphAsymmErrors* window = pyramid->makeWindow(getXmin(), getXmax(),
+                                                    nPixels);
+    if (!window || window->GetN() == 0) {
+      delete window;
+      continue;
+    }
+
+    int index = nObj() + drawGraphVec.size() - graphVec.size();
+    window->SetLineColor(pickColor(index));
+    window->SetMarkerColor(pickColor(index));
+    window->SetMarkerStyle(pickMarker(index));
+    window->SetLineWidth(2);
+    window->SetMarkerSize(.5);
+
+    for (int i = 0; i < window->GetN(); ++i) {
+      double high = GetPointY(window, i) + window->GetErrorYhigh(i);
+      double low = GetPointY(window, i) - window->GetErrorYlow(i);
+      if (!hasRange) {
+        yMin = low;
+        yMax = high;
+        hasRange = true;
+      }
+      if (high > yMax) {
+        yMax = high;
+      }
+      if (low < yMin) {
+        yMin = low;
+      }
+    }
+    drawGraphVec.emplace_back(window);
+  }
+
   gStyle->SetOptStat(0);
   gPad->SetLogx(getLogX());
   gPad->SetLogy(getLogY());
 
-  if (getYmin() < getYmax()) {
+  if (yMin < yMax) {
     if (getLogY()) {
-      setYmin(0.5 * getYmin());
-      setYmax(1.5 * getYmax());
-      if (getYmin() <= 0.) {
-        setYmin(0.1 * getYmax());
-        std::cerr << "WARNING: At least one data point is not positive!"
-                  << std::endl;
+      yMin = 0.5 * yMin;
+      yMax = 1.5 * yMax;
+      if (yMin <= 0.) {
+        yMin = 0.1 * yMax;
+        THROW_LOG_WARNING("Throw::Plotter1D::draw -- "
+                          "At least one data point is not positive!");
         /**
          * \todo Find first non-zero data point in separate function.
          */
       }
     } else {
-      double padding = 0.1 * fabs(getYmax());
-      if (padding < 0.1 * fabs(getYmin())) {
-        padding = 0.1 * fabs(getYmin());
+      double padding = 0.1 * fabs(yMax);
+      if (padding < 0.1 * fabs(yMin)) {
+        padding = 0.1 * fabs(yMin);
       }
 
-      setYmin(getYmin() - padding);
-      setYmax(getYmax() + padding);
+      yMin -= padding;
+      yMax += padding;
     }
   }
 
@@ -316,8 +375,8 @@ void Throw::Plotter1D::draw() {
     if (getXmax() > getXmin()) {
       histVec.at(i)->GetXaxis()->SetRangeUser(getXmin(), getXmax());
     }
-    histVec.at(i)->SetMinimum(getYmin());
-    histVec.at(i)->SetMaximum(getYmax());
+    histVec.at(i)->SetMinimum(yMin);
+    histVec.at(i)->SetMaximum(yMax);
 
     histVec.at(i)->GetXaxis()->SetTitle(getXlabel().c_str());
     histVec.at(i)->GetYaxis()->SetTitle(getYlabel().c_str());
@@ -334,36 +393,42 @@ void Throw::Plotter1D::draw() {
     ++nDraw;
   }
 
-  for (int i = 0; i < graphVec.size(); ++i) {
-    graphVec.at(i)->GetXaxis()->SetLabelFont(43);
-    graphVec.at(i)->GetXaxis()->SetLabelSize(12);
-    graphVec.at(i)->GetXaxis()->SetTitleFont(43);
-    graphVec.at(i)->GetXaxis()->SetTitleSize(12);
-    graphVec.at(i)->GetXaxis()->SetTitleOffset(getXoffset());
+  for (int i = 0; i < drawGraphVec.size(); ++i) {
+    TGraphAsymmErrors* graph = drawGraphVec.at(i);
+    std::string drawParam = "E1P";
+    if (i < graphVec.size()) {
+      drawParam = getGraphDrawParam(i);
+    }
 
-    graphVec.at(i)->GetYaxis()->SetLabelFont(43);
-    graphVec.at(i)->GetYaxis()->SetLabelSize(12);
-    graphVec.at(i)->GetYaxis()->SetTitleFont(43);
-    graphVec.at(i)->GetYaxis()->SetTitleSize(12);
-    graphVec.at(i)->GetYaxis()->SetTitleOffset(getYoffset());
+    graph->GetXaxis()->SetLabelFont(43);
+    graph->GetXaxis()->SetLabelSize(12);
+    graph->GetXaxis()->SetTitleFont(43);
+    graph->GetXaxis()->SetTitleSize(12);
+    graph->GetXaxis()->SetTitleOffset(getXoffset());
+
+    graph->GetYaxis()->SetLabelFont(43);
+    graph->GetYaxis()->SetLabelSize(12);
+    graph->GetYaxis()->SetTitleFont(43);
+    graph->GetYaxis()->SetTitleSize(12);
+    graph->GetYaxis()->SetTitleOffset(getYoffset());
 
     if (getXmax() > getXmin()) {
-      graphVec.at(i)->GetXaxis()->SetRangeUser(getXmin(), getXmax());
+      graph->GetXaxis()->SetRangeUser(getXmin(), getXmax());
     }
-    graphVec.at(i)->SetMinimum(getYmin());
-    graphVec.at(i)->SetMaximum(getYmax());
+    graph->SetMinimum(yMin);
+    graph->SetMaximum(yMax);
 
-    graphVec.at(i)->GetXaxis()->SetTitle(getXlabel().c_str());
-    graphVec.at(i)->GetYaxis()->SetTitle(getYlabel().c_str());
+    graph->GetXaxis()->SetTitle(getXlabel().c_str());
+    graph->GetYaxis()->SetTitle(getYlabel().c_str());
 
-    if (drawLegend) legend->AddEntry(graphVec.at(i), graphVec.at(i)->GetTitle(),
-                                     (getGraphDrawParam(i) + "L").c_str());
-    graphVec.at(i)->SetTitle("");
+    if (drawLegend) legend->AddEntry(graph, graph->GetTitle(),
+                                     (drawParam + "L").c_str());
+    graph->SetTitle("");
 
     if (nDraw == 0) {
-      graphVec.at(i)->Draw((getGraphDrawParam(i) + "A").c_str());
+      graph->Draw((drawParam + "A").c_str());
     } else {
-      graphVec.at(i)->Draw((getGraphDrawParam(i) + "same").c_str());
+      graph->Draw((drawParam + "same").c_str());
     }
     ++nDraw;
   }
@@ -400,6 +465,10 @@ void Throw::Plotter1D::draw() {
     ++nDraw;
   }
 
+  if (getRasterize() && nDraw > 0) {
+    rasterizeDataLayer(canvas);
+  }
+
   if (drawLegend) {
     putNotesToLegend(legend);
     legend->Draw();
@@ -430,9 +499,15 @@ void Throw::Plotter1D::draw() {
     labelVec.at(i)->Draw();
   }
 
-  canvas->Update();
-  canvas->Print((getOutFilePath() + ".pdf").c_str());
+  {
+    THROW_TRACE("Throw::Plotter1D::draw -- Print");
+    canvas->Update();
+    canvas->Print((getOutFilePath() + ".pdf").c_str());
+  }
 
+  for (size_t i = graphVec.size(); i < drawGraphVec.size(); ++i) {
+    delete drawGraphVec.at(i);
+  }
   delete canvas;
   delete legend;
   delete atlasLabel;
@@ -86,7 +86,7 @@ void Throw::Plotter2D::rotateGraphsMarkers(int diff = 0) {
  */
 void Throw::Plotter2D::addHist(TH2D* inHist) {
   if (!inHist) {
-    throw "ERROR: Empty histogram added!";
+    throw Exception("Throw::Plotter2D::addHist", "Empty histogram added");
   }
 
   std::string histName = inHist->GetName();
@@ -115,7 +115,7 @@ void Throw::Plotter2D::addHist(TH2D* inHist) {
  */
 void Throw::Plotter2D::addGraph(TGraph2D* inGraph) {
   if (!inGraph) {
-    throw "ERROR: Empty graph added!";
+    throw Exception("Throw::Plotter2D::addGraph", "Empty graph added");
   }
 
   std::string graphName = inGraph->GetName();
@@ -167,6 +167,7 @@ TGraph2D* Throw::Plotter2D::getGraph(int index) {
  * \brief Plot drawing function.
  */
 void Throw::Plotter2D::draw() {
+  THROW_TRACE("Throw::Plotter2D::draw");
   TCanvas *canvas = new TCanvas("canvas", "Canvas", 350, 350);
   gPad->SetTopMargin(.05);
   gPad->SetLeftMargin(.10);
@@ -300,6 +301,10 @@ void Throw::Plotter2D::draw() {
     ++nDraw;
   }
 
+  if (getRasterize() && nDraw > 0) {
+    rasterizeDataLayer(canvas);
+  }
+
   if (drawLegend) {
     putNotesToLegend(legend);
     legend->Draw();
@@ -322,8 +327,11 @@ void Throw::Plotter2D::draw() {
     atlasLabel = new TPaveText();
   }
 
-  canvas->Update();
-  canvas->Print((getOutFilePath() + ".pdf").c_str());
+  {
+    THROW_TRACE("Throw::Plotter2D::draw -- Print");
+    canvas->Update();
+    canvas->Print((getOutFilePath() + ".pdf").c_str());
+  }
 
   delete canvas;
   delete legend;
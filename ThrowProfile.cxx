@@ -0,0 +1,469 @@
+/**
+ * \file ThrowProfile.cxx
+ * \brief Implementation of scoped timers and profiling registry.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <cctype>
+#include <iostream>
+// Root
+#include <TH1.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Number of sites in one page of per-thread statistics.
+ */
+static const size_t kPageSize = 64;
+
+/**
+ * \brief Maximal number of pages, limits number of distinct sites.
+ */
+static const size_t kNpages = 64;
+
+/**
+ * \brief Statistics of one site in one thread.
+ *
+ * Written only by the owning thread, atomics allow other threads to read
+ * them without locks.
+ */
+struct ProfileSlot {
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> total;
+  std::atomic<uint64_t> min;
+  std::atomic<uint64_t> max;
+  std::atomic<uint64_t> histogram[Throw::ProfileRegistry::kNbins];
+
+  ProfileSlot() {
+    clear();
+  }
+
+  void clear() {
+    count.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    min.store(UINT64_MAX, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+    for (auto &bin : histogram) {
+      bin.store(0, std::memory_order_relaxed);
+    }
+  }
+};
+
+/**
+ * \brief Add statistics of the source slot to the target slot.
+ *
+ * Target has to be accessed only by the calling thread.
+ */
+static void MergeSlot(ProfileSlot& target, const ProfileSlot& source) {
+  auto add = [](std::atomic<uint64_t>& value,
+                const std::atomic<uint64_t>& diff) {
+    value.store(value.load(std::memory_order_relaxed) +
+                diff.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+  };
+  add(target.count, source.count);
+  add(target.total, source.total);
+  for (size_t i = 0; i < Throw::ProfileRegistry::kNbins; ++i) {
+    add(target.histogram[i], source.histogram[i]);
+  }
+  target.min.store(std::min(target.min.load(std::memory_order_relaxed),
+                            source.min.load(std::memory_order_relaxed)),
+                   std::memory_order_relaxed);
+  target.max.store(std::max(target.max.load(std::memory_order_relaxed),
+                            source.max.load(std::memory_order_relaxed)),
+                   std::memory_order_relaxed);
+}
+
+/**
+ * \brief Statistics of all sites in one thread.
+ *
+ * Pages are allocated by the owning thread when needed. Epoch is the reset
+ * period the statistics belong to.
+ */
+struct ThreadProfile {
+  std::atomic<ProfileSlot*> pageVec[kNpages];
+  std::atomic<uint64_t> epoch;
+
+  ThreadProfile() {
+    for (auto &page : pageVec) {
+      page.store(nullptr, std::memory_order_relaxed);
+    }
+    epoch.store(0, std::memory_order_relaxed);
+  }
+
+  ~ThreadProfile() {
+    for (auto &page : pageVec) {
+      delete[] page.load();
+    }
+  }
+
+  void clear() {
+    for (auto &page : pageVec) {
+      ProfileSlot* slots = page.load(std::memory_order_relaxed);
+      if (!slots) {
+        continue;
+      }
+      for (size_t i = 0; i < kPageSize; ++i) {
+        slots[i].clear();
+      }
+    }
+  }
+};
+
+/**
+ * \brief Registered sites and threads.
+ *
+ * Statistics of the exited threads are merged into the retired profile,
+ * which is accessed only with the registry mutex held.
+ */
+static std::mutex registryMutex;
+static std::vector<std::string> siteNames;
+static std::unordered_map<std::string, size_t> siteIndex;
+static std::vector<ThreadProfile*> threadProfiles;
+static ThreadProfile retiredProfile;
+
+/**
+ * \brief Current reset period, statistics of older periods are ignored.
+ */
+static std::atomic<uint64_t> resetEpoch(0);
+
+/**
+ * \brief Owns statistics of the current thread.
+ *
+ * When the thread exits the statistics are merged into the retired profile
+ * and unregistered, so the pages of exited threads are released.
+ */
+struct ThreadProfileOwner {
+  ThreadProfile* profile = nullptr;
+
+  ~ThreadProfileOwner() {
+    if (!profile) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (profile->epoch.load(std::memory_order_relaxed) ==
+        resetEpoch.load(std::memory_order_relaxed)) {
+      for (size_t p = 0; p < kNpages; ++p) {
+        ProfileSlot* slots = profile->pageVec[p].load();
+        if (!slots) {
+          continue;
+        }
+        ProfileSlot* retired = retiredProfile.pageVec[p].load();
+        if (!retired) {
+          retired = new ProfileSlot[kPageSize];
+          retiredProfile.pageVec[p].store(retired);
+        }
+        for (size_t i = 0; i < kPageSize; ++i) {
+          MergeSlot(retired[i], slots[i]);
+        }
+      }
+    }
+
+    threadProfiles.erase(std::find(threadProfiles.begin(),
+                                   threadProfiles.end(), profile));
+    delete profile;
+  }
+};
+
+/**
+ * \brief Get statistics of the current thread, registers the thread at the
+ * first call.
+ *
+ * Statistics of an earlier reset period are cleared by the owning thread
+ * itself, so resetting doesn't race with the measurements.
+ */
+static ThreadProfile& GetThreadProfile() {
+  thread_local ThreadProfileOwner owner;
+  if (!owner.profile) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    owner.profile = new ThreadProfile();
+    owner.profile->epoch.store(resetEpoch.load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+    threadProfiles.emplace_back(owner.profile);
+  }
+
+  uint64_t epoch = resetEpoch.load(std::memory_order_acquire);
+  if (owner.profile->epoch.load(std::memory_order_relaxed) != epoch) {
+    owner.profile->clear();
+    owner.profile->epoch.store(epoch, std::memory_order_release);
+  }
+
+  return *owner.profile;
+}
+
+/**
+ * \brief Get histogram bin of the duration.
+ *
+ * \param duration duration in nanoseconds.
+ */
+static size_t GetBin(uint64_t duration) {
+  if (duration == 0) {
+    return 0;
+  }
+  size_t bin = 64 - __builtin_clzll(duration);
+
+  return std::min(bin, Throw::ProfileRegistry::kNbins - 1);
+}
+
+/**
+ * \brief Add the duration to the statistics of the current thread.
+ *
+ * \param site index of the site.
+ * \param duration duration in nanoseconds.
+ */
+static void Record(size_t site, uint64_t duration) {
+  ThreadProfile& profile = GetThreadProfile();
+  std::atomic<ProfileSlot*>& page = profile.pageVec[site / kPageSize];
+  ProfileSlot* slots = page.load(std::memory_order_relaxed);
+  if (!slots) {
+    slots = new ProfileSlot[kPageSize];
+    page.store(slots, std::memory_order_release);
+  }
+
+  // Only this thread writes to the slot, no read-modify-write needed
+  ProfileSlot& slot = slots[site % kPageSize];
+  auto add = [](std::atomic<uint64_t>& value, uint64_t diff) {
+    value.store(value.load(std::memory_order_relaxed) + diff,
+                std::memory_order_relaxed);
+  };
+  add(slot.count, 1);
+  add(slot.total, duration);
+  add(slot.histogram[GetBin(duration)], 1);
+  if (duration < slot.min.load(std::memory_order_relaxed)) {
+    slot.min.store(duration, std::memory_order_relaxed);
+  }
+  if (duration > slot.max.load(std::memory_order_relaxed)) {
+    slot.max.store(duration, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * \brief Constructor of ProfileSite.
+ *
+ * \param name name of the site.
+ */
+Throw::ProfileSite::ProfileSite(const std::string& name) {
+  index = ProfileRegistry::registerSite(name);
+}
+
+/**
+ * \brief Get index of the site in the registry.
+ */
+size_t Throw::ProfileSite::getIndex() const {
+
+  return index;
+}
+
+/**
+ * \brief Start measuring the site.
+ *
+ * \param site profile site.
+ */
+Throw::ScopedTimer::ScopedTimer(const ProfileSite& site) {
+  siteIndex = site.getIndex();
+  start = std::chrono::steady_clock::now();
+}
+
+/**
+ * \brief Start measuring the site.
+ *
+ * Looks up the site by name, prefer ScopedTimer(const ProfileSite&) in hot
+ * code.
+ *
+ * \param name name of the site.
+ */
+Throw::ScopedTimer::ScopedTimer(const std::string& name) {
+  siteIndex = ProfileRegistry::registerSite(name);
+  start = std::chrono::steady_clock::now();
+}
+
+/**
+ * \brief Stop measuring and record the duration.
+ */
+Throw::ScopedTimer::~ScopedTimer() {
+  auto duration = std::chrono::steady_clock::now() - start;
+  Record(siteIndex,
+         std::chrono::duration_cast<std::chrono::nanoseconds>(
+             duration).count());
+}
+
+/**
+ * \brief Register the site.
+ *
+ * \param name name of the site.
+ *
+ * \return index of the site, same for the same name.
+ */
+size_t Throw::ProfileRegistry::registerSite(const std::string& name) {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto itr = siteIndex.find(name);
+  if (itr != siteIndex.end()) {
+    return itr->second;
+  }
+  if (siteNames.size() >= kPageSize * kNpages) {
+    throw Exception("Throw::ProfileRegistry::registerSite", "Too many sites");
+  }
+
+  siteIndex.emplace(name, siteNames.size());
+  siteNames.emplace_back(name);
+
+  return siteNames.size() - 1;
+}
+
+/**
+ * \brief Merge statistics of all threads.
+ *
+ * Only sites which were measured at least once are returned, sorted by the
+ * total time.
+ */
+std::vector<Throw::ProfileStats> Throw::ProfileRegistry::collect() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+
+  std::vector<ProfileStats> statsVec(siteNames.size());
+  for (size_t i = 0; i < siteNames.size(); ++i) {
+    statsVec[i].name = siteNames[i];
+    statsVec[i].count = 0;
+    statsVec[i].total = 0;
+    statsVec[i].min = UINT64_MAX;
+    statsVec[i].max = 0;
+    statsVec[i].histogram.assign(kNbins, 0);
+  }
+
+  // Threads which didn't notice the last reset yet hold stale statistics
+  std::vector<ThreadProfile*> profiles = {&retiredProfile};
+  uint64_t epoch = resetEpoch.load(std::memory_order_relaxed);
+  for (auto &profile : threadProfiles) {
+    if (profile->epoch.load(std::memory_order_acquire) == epoch) {
+      profiles.emplace_back(profile);
+    }
+  }
+
+  for (auto &profile : profiles) {
+    for (size_t i = 0; i < siteNames.size(); ++i) {
+      ProfileSlot* slots =
+          profile->pageVec[i / kPageSize].load(std::memory_order_acquire);
+      if (!slots) {
+        continue;
+      }
+      ProfileSlot& slot = slots[i % kPageSize];
+      ProfileStats& stats = statsVec[i];
+      stats.count += slot.count.load(std::memory_order_relaxed);
+      stats.total += slot.total.load(std::memory_order_relaxed);
+      stats.min = std::min(stats.min,
+                           slot.min.load(std::memory_order_relaxed));
+      stats.max = std::max(stats.max,
+                           slot.max.load(std::memory_order_relaxed));
+      for (size_t j = 0; j < kNbins; ++j) {
+        stats.histogram[j] +=
+            slot.histogram[j].load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  statsVec.erase(std::remove_if(statsVec.begin(), statsVec.end(),
+                                [](const ProfileStats& stats) {
+                                  return stats.count == 0;
+                                }),
+                 statsVec.end());
+  std::sort(statsVec.begin(), statsVec.end(),
+            [](const ProfileStats& a, const ProfileStats& b) {
+              return a.total > b.total;
+            });
+
+  return statsVec;
+}
+
+/**
+ * \brief Get report of all sites sorted by the total time.
+ */
+std::string Throw::ProfileRegistry::report() {
+  std::vector<ProfileStats> statsVec = collect();
+
+  std::string out = "Profile report, " + Now() + "\n";
+  char line[256];
+  snprintf(line, sizeof(line), "%-32s %10s %12s %12s %12s %12s\n",
+           "Name", "Count", "Total [ms]", "Mean [us]", "Min [us]", "Max [us]");
+  out += line;
+  for (auto &stats : statsVec) {
+    snprintf(line, sizeof(line), "%-32s %10llu %12.3f %12.3f %12.3f %12.3f\n",
+             stats.name.c_str(), (unsigned long long) stats.count,
+             stats.total / 1e6, stats.total / 1e3 / stats.count,
+             stats.min / 1e3, stats.max / 1e3);
+    out += line;
+  }
+
+  return out;
+}
+
+/**
+ * \brief Print report to the standard output.
+ */
+void Throw::ProfileRegistry::print() {
+  std::cout << report();
+}
+
+/**
+ * \brief Write duration histograms of all sites to the root file.
+ *
+ * Histograms are named "profile_<site name>", the bin edges are in
+ * nanoseconds.
+ *
+ * \param filePath path to the root file.
+ */
+void Throw::ProfileRegistry::write(const std::string& filePath) {
+  std::vector<ProfileStats> statsVec = collect();
+
+  std::vector<double> binEdges(kNbins + 1);
+  binEdges[0] = 0.;
+  for (size_t i = 1; i <= kNbins; ++i) {
+    binEdges[i] = uint64_t(1) << (i - 1);
+  }
+
+  QuickOutSession session;
+  for (auto &stats : statsVec) {
+    std::string histName = "profile_" + stats.name;
+    for (auto &character : histName) {
+      if (!isalnum(character)) {
+        character = '_';
+      }
+    }
+
+    std::string histTitle = stats.name + ";Duration [ns];Scopes";
+    TH1D* hist = new TH1D(histName.c_str(), histTitle.c_str(), kNbins,
+                          binEdges.data());
+    hist->SetDirectory(nullptr);
+    for (size_t i = 0; i < kNbins; ++i) {
+      hist->SetBinContent(i + 1, stats.histogram[i]);
+    }
+    hist->SetEntries(stats.count);
+
+    session.write(hist, filePath, histName);
+    delete hist;
+  }
+  session.close();
+}
+
+/**
+ * \brief Reset statistics of all threads.
+ *
+ * Running threads clear their own statistics at their next measurement, until
+ * then they are left out of the collected statistics. Durations recorded
+ * while resetting count to the previous period.
+ */
+void Throw::ProfileRegistry::reset() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  resetEpoch.fetch_add(1, std::memory_order_release);
+  retiredProfile.clear();
+}
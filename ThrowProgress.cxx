@@ -0,0 +1,257 @@
+/**
+ * \file ThrowProgress.cxx
+ * \brief Implementation of the Progress meter.
+ */
+
+
+// std
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+// POSIX
+#include <unistd.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Width of the progress bar in characters.
+ */
+static const int kBarWidth = 20;
+
+/**
+ * \brief Format duration as "HH:MM:SS".
+ */
+static void FormatDuration(double seconds, char* buffer, size_t size) {
+  if (seconds < 0. || seconds > 359999.) {
+    snprintf(buffer, size, "--:--:--");
+    return;
+  }
+  // Hours have at most two digits after the check above
+  int total = seconds;
+  snprintf(buffer, size, "%02d:%02d:%02d",
+           total / 3600 % 100, total / 60 % 60, total % 60);
+}
+
+/**
+ * \brief Format rate with metric prefix, e.g. "12.3k/s".
+ */
+static void FormatRate(double rate, char* buffer, size_t size) {
+  const char* prefixes = " kMGT";
+  int i = 0;
+  while (rate >= 1000. && i < 4) {
+    rate /= 1000.;
+    ++i;
+  }
+  if (i == 0) {
+    snprintf(buffer, size, "%.1f/s", rate);
+  } else {
+    snprintf(buffer, size, "%.1f%c/s", rate, prefixes[i]);
+  }
+}
+
+/**
+ * \brief Constructor of Progress.
+ *
+ * \param total expected count, 0 if unknown.
+ */
+Throw::Progress::Progress(uint64_t total) :
+    Progress(total, "Progress") {
+}
+
+/**
+ * \brief Constructor of Progress.
+ *
+ * The mode is "Bar" if the standard error output is a terminal and "Quiet"
+ * otherwise.
+ *
+ * \param total expected count, 0 if unknown.
+ * \param label label printed in front of the progress.
+ */
+Throw::Progress::Progress(uint64_t total, const std::string& label) :
+    Progress(total, label, isatty(fileno(stderr)) ? "Bar" : "Quiet") {
+}
+
+/**
+ * \brief Constructor of Progress.
+ *
+ * \param total expected count, 0 if unknown.
+ * \param label label printed in front of the progress.
+ * \param mode "Bar" or "Quiet".
+ */
+Throw::Progress::Progress(uint64_t total,
+                          const std::string& label,
+                          const std::string& mode) {
+  if (mode.compare("Bar") == 0) {
+    quiet = false;
+    interval = std::chrono::duration<double>(.2);
+  } else if (mode.compare("Quiet") == 0) {
+    quiet = true;
+    interval = std::chrono::duration<double>(30.);
+  } else {
+    throw Exception("Throw::Progress", "Unknown mode");
+  }
+
+  count.store(0);
+  this->total = total;
+  this->label = label;
+  finished = false;
+  start = std::chrono::steady_clock::now();
+  renderThread = std::thread(&Progress::run, this);
+}
+
+/**
+ * \brief Destructor of Progress, finishes the progress.
+ */
+Throw::Progress::~Progress() {
+  finish();
+}
+
+/**
+ * \brief Increment the counter by one.
+ */
+void Throw::Progress::add() {
+  count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Increment the counter.
+ *
+ * Adding in chunks is cheaper when many threads share the meter.
+ *
+ * \param diff increment.
+ */
+void Throw::Progress::add(uint64_t diff) {
+  count.fetch_add(diff, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Get current count.
+ */
+uint64_t Throw::Progress::getCount() {
+
+  return count.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Set time between two renders.
+ *
+ * Applies right away, the next render is due the interval after the last one.
+ *
+ * \param seconds interval in seconds.
+ */
+void Throw::Progress::setInterval(double seconds) {
+  if (seconds <= 0.) {
+    throw Exception("Throw::Progress::setInterval",
+                    "Interval has to be positive");
+  }
+  std::lock_guard<std::mutex> lock(renderMutex);
+  interval = std::chrono::duration<double>(seconds);
+  renderChanged.notify_one();
+}
+
+/**
+ * \brief Stop the render thread and print the final state.
+ */
+void Throw::Progress::finish() {
+  {
+    std::lock_guard<std::mutex> lock(renderMutex);
+    if (finished) {
+      return;
+    }
+    finished = true;
+  }
+  renderChanged.notify_one();
+  renderThread.join();
+
+  render(true);
+}
+
+/**
+ * \brief Render the progress periodically until finished.
+ */
+void Throw::Progress::run() {
+  std::unique_lock<std::mutex> lock(renderMutex);
+  auto lastRender = std::chrono::steady_clock::now();
+  while (!finished) {
+    // Recomputed after every wake up, the interval might have changed
+    auto next = lastRender + interval;
+    if (renderChanged.wait_until(lock, next) != std::cv_status::timeout) {
+      continue;
+    }
+    render(false);
+    lastRender = std::chrono::steady_clock::now();
+  }
+}
+
+/**
+ * \brief Print the progress.
+ *
+ * \param last whether this is the final state.
+ */
+void Throw::Progress::render(bool last) {
+  uint64_t current = count.load(std::memory_order_relaxed);
+  double elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  double rate = elapsed > 0. ? current / elapsed : 0.;
+
+  char rateStr[32];
+  FormatRate(rate, rateStr, sizeof(rateStr));
+  char elapsedStr[16];
+  FormatDuration(elapsed, elapsedStr, sizeof(elapsedStr));
+  char etaStr[16];
+  FormatDuration(-1., etaStr, sizeof(etaStr));
+  double fraction = 0.;
+  if (total > 0) {
+    fraction = current < total ? double(current) / total : 1.;
+    if (rate > 0.) {
+      uint64_t remaining = current < total ? total - current : 0;
+      FormatDuration(remaining / rate, etaStr, sizeof(etaStr));
+    }
+  }
+
+  char line[512];
+  if (quiet) {
+    char timeStr[32];
+    FormatNow(timeStr, sizeof(timeStr));
+    if (last) {
+      snprintf(line, sizeof(line), "%s %s: done, %llu in %s, %s\n",
+               timeStr, label.c_str(), (unsigned long long) current,
+               elapsedStr, rateStr);
+    } else if (total > 0) {
+      snprintf(line, sizeof(line), "%s %s: %.1f%% (%llu/%llu), %s, ETA %s\n",
+               timeStr, label.c_str(), 100. * fraction,
+               (unsigned long long) current, (unsigned long long) total,
+               rateStr, etaStr);
+    } else {
+      snprintf(line, sizeof(line), "%s %s: %llu, %s\n",
+               timeStr, label.c_str(), (unsigned long long) current, rateStr);
+    }
+  } else {
+    char bar[kBarWidth + 1];
+    int nFilled = fraction * kBarWidth;
+    for (int i = 0; i < kBarWidth; ++i) {
+      bar[i] = i < nFilled ? '#' : ' ';
+    }
+    bar[kBarWidth] = '\0';
+
+    if (total > 0) {
+      snprintf(line, sizeof(line), "\r%s [%s] %5.1f%% %llu/%llu %s %s %s%s",
+               label.c_str(), bar, 100. * fraction,
+               (unsigned long long) current, (unsigned long long) total,
+               rateStr, last ? "in" : "ETA", last ? elapsedStr : etaStr,
+               last ? "\x1b[K\n" : "\x1b[K");
+    } else {
+      snprintf(line, sizeof(line), "\r%s %llu %s %s%s",
+               label.c_str(), (unsigned long long) current, rateStr,
+               elapsedStr, last ? "\x1b[K\n" : "\x1b[K");
+    }
+  }
+
+  fputs(line, stderr);
+  fflush(stderr);
+}
@@ -0,0 +1,237 @@
+/**
+ * \file ThrowQuickOutSession.cxx
+ * \brief Implementation of QuickOutSession.
+ */
+
+
+// std
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+#include <system_error>
+// Root
+#include <TFile.h>
+#include <TDirectory.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Default constructor of QuickOutSession.
+ *
+ * Files are written with the ROOT default compression.
+ */
+Throw::QuickOutSession::QuickOutSession() : QuickOutSession("default") {
+}
+
+/**
+ * \brief Constructor of QuickOutSession with compression profile.
+ *
+ * \param profile compression profile, see Throw::GetCompressionSettings.
+ */
+Throw::QuickOutSession::QuickOutSession(const std::string& profile) {
+  compression = GetCompressionSettings(profile);
+  maxOpenFiles = 0;
+  useCount = 0;
+}
+
+/**
+ * \brief Flush and close all files opened by the session.
+ */
+Throw::QuickOutSession::~QuickOutSession() {
+  close();
+}
+
+/**
+ * \brief Get path of the least recently used file.
+ *
+ * \param lastUseMap last use of every file, must not be empty.
+ */
+static std::string GetLeastRecent(
+    const std::unordered_map<std::string, uint64_t>& lastUseMap) {
+  auto oldest = lastUseMap.begin();
+  for (auto itr = lastUseMap.begin(); itr != lastUseMap.end(); ++itr) {
+    if (itr->second < oldest->second) {
+      oldest = itr;
+    }
+  }
+
+  return oldest->first;
+}
+
+/**
+ * \brief Set maximum number of files kept open at once.
+ *
+ * When the limit is reached the least recently used file is closed, if it's
+ * written again it's reopened for update.
+ *
+ * \param maxFiles maximum number of open files, 0 means unlimited.
+ */
+void Throw::QuickOutSession::setMaxOpenFiles(size_t maxFiles) {
+  maxOpenFiles = maxFiles;
+  while (maxOpenFiles > 0 && fileMap.size() > maxOpenFiles) {
+    closeFile(GetLeastRecent(lastUseMap));
+  }
+}
+
+/**
+ * \brief Get open file for the path, create it if needed.
+ *
+ * Directories are created without spawning a shell and every file is
+ * recreated only once per session, files closed to respect the limit on open
+ * files are reopened for update. Current directory is left untouched, so
+ * objects created while the session is open don't end up in its files.
+ * Failures aren't remembered, the next write to the path tries again.
+ *
+ * \param filePath root file path.
+ */
+TFile* Throw::QuickOutSession::getFile(const std::string& filePath) {
+  auto itr = fileMap.find(filePath);
+  if (itr != fileMap.end()) {
+    lastUseMap[filePath] = ++useCount;
+    return itr->second;
+  }
+
+  if (maxOpenFiles > 0 && fileMap.size() >= maxOpenFiles) {
+    closeFile(GetLeastRecent(lastUseMap));
+  }
+
+  std::string dirPath = std::filesystem::path(filePath).parent_path().string();
+  if (!dirPath.empty() && dirSet.find(dirPath) == dirSet.end()) {
+    std::error_code error;
+    std::filesystem::create_directories(dirPath, error);
+    if (error) {
+      THROW_LOG_ERROR("Throw::QuickOutSession -- Can't create directory " +
+                      dirPath + ": " + error.message());
+      return nullptr;
+    }
+    dirSet.emplace(dirPath);
+  }
+
+  const char* mode = "RECREATE";
+  if (createdSet.find(filePath) != createdSet.end()) {
+    mode = "UPDATE";
+  }
+
+  TDirectory::TContext context;
+  TFile* outFile;
+  if (compression < 0) {
+    outFile = new TFile(filePath.c_str(), mode);
+  } else {
+    outFile = new TFile(filePath.c_str(), mode, "", compression);
+  }
+  if (!outFile->IsOpen()) {
+    delete outFile;
+    return nullptr;
+  }
+  createdSet.emplace(filePath);
+  fileMap[filePath] = outFile;
+  lastUseMap[filePath] = ++useCount;
+
+  return outFile;
+}
+
+/**
+ * \brief Flush and close one file of the session.
+ *
+ * \param filePath root file path.
+ */
+void Throw::QuickOutSession::closeFile(const std::string& filePath) {
+  auto itr = fileMap.find(filePath);
+  if (itr == fileMap.end()) {
+    return;
+  }
+
+  if (itr->second) {
+    itr->second->Write();
+    itr->second->Close();
+    delete itr->second;
+  }
+  fileMap.erase(itr);
+  lastUseMap.erase(filePath);
+}
+
+/**
+ * \brief Write object to a root file under its own name.
+ *
+ * \param object object to be written.
+ * \param filePath root file path.
+ */
+bool Throw::QuickOutSession::write(TObject* object,
+                                   const std::string& filePath) {
+
+  return write(object, filePath, "");
+}
+
+/**
+ * \brief Write object to a root file.
+ *
+ * The file is recreated when it's used for the first time in the session,
+ * object written under the same name again replaces the previous one.
+ *
+ * \param object object to be written.
+ * \param filePath root file path.
+ * \param name object name, name of the object is used if empty.
+ */
+bool Throw::QuickOutSession::write(TObject* object,
+                                   const std::string& filePath,
+                                   const std::string& name) {
+  if (!object) {
+    throw Exception("Throw::QuickOutSession::write", "Null TObject* provided");
+  }
+
+  TFile* outFile = getFile(filePath);
+  if (!outFile) {
+    return false;
+  }
+
+  std::string objectName = object->GetName();
+  if (!name.empty()) {
+    objectName = name;
+  }
+
+  return outFile->WriteTObject(object, objectName.c_str(), "Overwrite") > 0;
+}
+
+/**
+ * \brief Flush one file of the session and keep it open.
+ *
+ * Files already closed to respect the limit on open files are up to date.
+ *
+ * \param filePath root file path.
+ */
+void Throw::QuickOutSession::flush(const std::string& filePath) {
+  auto itr = fileMap.find(filePath);
+  if (itr != fileMap.end() && itr->second) {
+    itr->second->Write();
+    itr->second->Flush();
+  }
+}
+
+/**
+ * \brief Flush all files opened by the session and keep them open.
+ */
+void Throw::QuickOutSession::flush() {
+  for (auto &file : fileMap) {
+    if (file.second) {
+      file.second->Write();
+      file.second->Flush();
+    }
+  }
+}
+
+/**
+ * \brief Flush and close all files opened by the session.
+ */
+void Throw::QuickOutSession::close() {
+  for (auto &file : fileMap) {
+    if (file.second) {
+      file.second->Write();
+      file.second->Close();
+      delete file.second;
+    }
+  }
+
+  fileMap.clear();
+  lastUseMap.clear();
+}
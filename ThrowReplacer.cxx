@@ -0,0 +1,146 @@
+/**
+ * \file ThrowReplacer.cxx
+ * \brief Implementation of Replacer.
+ */
+
+
+// std
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <queue>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Build the Aho-Corasick automaton of the patterns.
+ *
+ * Transitions are precomputed for every character, so the rewrite does one
+ * table lookup per input character.
+ *
+ * \param replacements map of patterns to their replacements.
+ */
+Throw::Replacer::Replacer(
+    const std::map<std::string, std::string>& replacements) {
+  transitionVec.assign(256, -1);
+  outputVec.assign(1, -1);
+  depthVec.assign(1, 0);
+
+  for (const auto &replacement : replacements) {
+    if (replacement.first.empty()) {
+      throw Exception("Throw::Replacer", "Empty pattern provided");
+    }
+
+    int state = 0;
+    for (unsigned char c : replacement.first) {
+      int next = transitionVec.at(256 * state + c);
+      if (next < 0) {
+        next = outputVec.size();
+        transitionVec.at(256 * state + c) = next;
+        transitionVec.resize(transitionVec.size() + 256, -1);
+        outputVec.emplace_back(-1);
+        depthVec.emplace_back(depthVec.at(state) + 1);
+      }
+      state = next;
+    }
+    outputVec.at(state) = patternLengthVec.size();
+    patternLengthVec.emplace_back(replacement.first.size());
+    replacementVec.emplace_back(replacement.second);
+  }
+
+  std::vector<int> failVec(outputVec.size(), 0);
+  std::queue<int> stateQueue;
+  for (int c = 0; c < 256; ++c) {
+    int& next = transitionVec.at(c);
+    if (next < 0) {
+      next = 0;
+    } else {
+      stateQueue.push(next);
+    }
+  }
+
+  while (!stateQueue.empty()) {
+    int state = stateQueue.front();
+    stateQueue.pop();
+
+    // Longer pattern ending at the state wins over the suffix ones
+    if (outputVec.at(state) < 0) {
+      outputVec.at(state) = outputVec.at(failVec.at(state));
+    }
+
+    for (int c = 0; c < 256; ++c) {
+      int& next = transitionVec.at(256 * state + c);
+      int fallback = transitionVec.at(256 * failVec.at(state) + c);
+      if (next < 0) {
+        next = fallback;
+      } else {
+        failVec.at(next) = fallback;
+        stateQueue.push(next);
+      }
+    }
+  }
+}
+
+/**
+ * \brief Replace all patterns in the string in one pass.
+ *
+ * The result is kept in an internal buffer, which is reused by the following
+ * calls.
+ *
+ * \param str string to be rewritten.
+ */
+const std::string& Throw::Replacer::replace(std::string_view str) {
+  replace(str, buffer);
+
+  return buffer;
+}
+
+/**
+ * \brief Replace all patterns in the string in one pass.
+ *
+ * Of overlapping matches the one starting first is replaced, of the ones
+ * starting at the same position the longest one, e.g. "%1" doesn't match
+ * inside of "%10". Replaced text is not searched again.
+ *
+ * \param str string to be rewritten.
+ * \param out output buffer, its capacity is reused.
+ */
+void Throw::Replacer::replace(std::string_view str, std::string& out) const {
+  out.clear();
+
+  int state = 0;
+  size_t copied = 0;
+  int pending = -1;
+  size_t pendingStart = 0;
+  size_t pendingEnd = 0;
+  const int* transitions = transitionVec.data();
+  size_t i = 0;
+  while (i < str.size()) {
+    state = transitions[256 * state + static_cast<unsigned char>(str[i])];
+    ++i;
+
+    int pattern = outputVec[state];
+    if (pattern >= 0) {
+      size_t start = i - patternLengthVec[pattern];
+      if (pending < 0 || start <= pendingStart) {
+        pending = pattern;
+        pendingStart = start;
+        pendingEnd = i;
+      }
+    }
+
+    // Matches still in progress start after the pending one, it's final
+    bool final = i == str.size() || i - depthVec[state] > pendingStart;
+    if (pending >= 0 && final) {
+      out.append(str.data() + copied, pendingStart - copied);
+      out.append(replacementVec[pending]);
+      copied = pendingEnd;
+      pending = -1;
+      state = 0;
+      i = pendingEnd;
+    }
+  }
+  out.append(str.data() + copied, str.size() - copied);
+}
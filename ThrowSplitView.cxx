@@ -0,0 +1,196 @@
+/**
+ * \file ThrowSplitView.cxx
+ * \brief Implementation of SplitView.
+ */
+
+
+// std
+#include <string>
+#include <string_view>
+#include <cstring>
+// SIMD
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Find position of the first delimiter at or after the position.
+ *
+ * Input is scanned 32 (AVX2) or 16 (SSE2) bytes at a time when the library
+ * is compiled for the instruction set, remainder is scanned byte by byte.
+ *
+ * Returns size of the string if no delimiter is found.
+ */
+static size_t FindDelimiter(std::string_view str,
+                            size_t pos,
+                            const std::string& delimiters) {
+  const char* data = str.data();
+  size_t size = str.size();
+
+  if (delimiters.size() == 1) {
+    const void* found = memchr(data + pos, delimiters.front(), size - pos);
+    return found ? static_cast<const char*>(found) - data : size;
+  }
+
+#if defined(__AVX2__)
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i chunk = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(data + pos));
+    __m256i match = _mm256_setzero_si256();
+    for (char delimiter : delimiters) {
+      match = _mm256_or_si256(match,
+          _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(delimiter)));
+    }
+    unsigned int mask = _mm256_movemask_epi8(match);
+    if (mask) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+#endif
+
+#if defined(__SSE2__)
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i chunk = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(data + pos));
+    __m128i match = _mm_setzero_si128();
+    for (char delimiter : delimiters) {
+      match = _mm_or_si128(match,
+          _mm_cmpeq_epi8(chunk, _mm_set1_epi8(delimiter)));
+    }
+    unsigned int mask = _mm_movemask_epi8(match);
+    if (mask) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+#endif
+
+  for (; pos < size; ++pos) {
+    if (delimiters.find(data[pos]) != std::string::npos) {
+      return pos;
+    }
+  }
+
+  return size;
+}
+
+/**
+ * \brief Split string at the delimiter.
+ *
+ * \param str string to be split, it has to outlive the view.
+ * \param delimiter delimiter character.
+ */
+Throw::SplitView::SplitView(std::string_view str, char delimiter) :
+    str(str), delimiters(1, delimiter) {
+}
+
+/**
+ * \brief Split string at any of the delimiters.
+ *
+ * \param str string to be split, it has to outlive the view.
+ * \param delimiters set of delimiter characters.
+ */
+Throw::SplitView::SplitView(std::string_view str,
+                            std::string_view delimiters) :
+    str(str), delimiters(delimiters) {
+  if (this->delimiters.empty()) {
+    throw Exception("Throw::SplitView", "Empty delimiter set provided");
+  }
+}
+
+/**
+ * \brief Find end of the token starting at the position.
+ */
+size_t Throw::SplitView::findTokenEnd(size_t pos) const {
+
+  return FindDelimiter(str, pos, delimiters);
+}
+
+/**
+ * \brief Iterator pointing to the first token.
+ */
+Throw::SplitView::Iterator Throw::SplitView::begin() const {
+  if (str.empty()) {
+    return end();
+  }
+
+  return Iterator(this, 0, findTokenEnd(0));
+}
+
+/**
+ * \brief Iterator pointing past the last token.
+ */
+Throw::SplitView::Iterator Throw::SplitView::end() const {
+
+  return Iterator(this, std::string_view::npos, std::string_view::npos);
+}
+
+/**
+ * \brief Default constructor of the SplitView iterator, not dereferenceable.
+ */
+Throw::SplitView::Iterator::Iterator() :
+    view(nullptr), tokenBegin(std::string_view::npos),
+    tokenEnd(std::string_view::npos) {
+}
+
+/**
+ * \brief Constructor of the SplitView iterator.
+ */
+Throw::SplitView::Iterator::Iterator(const SplitView* view,
+                                     size_t tokenBegin,
+                                     size_t tokenEnd) :
+    view(view), tokenBegin(tokenBegin), tokenEnd(tokenEnd) {
+}
+
+/**
+ * \brief Current token.
+ */
+std::string_view Throw::SplitView::Iterator::operator*() const {
+
+  return view->str.substr(tokenBegin, tokenEnd - tokenBegin);
+}
+
+/**
+ * \brief Advance to the next token.
+ *
+ * Like std::getline, empty token after the trailing delimiter is skipped.
+ */
+Throw::SplitView::Iterator& Throw::SplitView::Iterator::operator++() {
+  if (tokenEnd + 1 >= view->str.size()) {
+    tokenBegin = std::string_view::npos;
+    tokenEnd = std::string_view::npos;
+  } else {
+    tokenBegin = tokenEnd + 1;
+    tokenEnd = view->findTokenEnd(tokenBegin);
+  }
+
+  return *this;
+}
+
+/**
+ * \brief Advance to the next token, return the current one.
+ */
+Throw::SplitView::Iterator Throw::SplitView::Iterator::operator++(int) {
+  Iterator previous = *this;
+  ++*this;
+
+  return previous;
+}
+
+/**
+ * \brief Compare iterators.
+ */
+bool Throw::SplitView::Iterator::operator==(const Iterator& other) const {
+
+  return tokenBegin == other.tokenBegin;
+}
+
+/**
+ * \brief Compare iterators.
+ */
+bool Throw::SplitView::Iterator::operator!=(const Iterator& other) const {
+
+  return tokenBegin != other.tokenBegin;
+}
@@ -5,8 +5,9 @@
 
 
 // std
-#include <sstream>
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
 // Throw
 #include "Throw.h"
@@ -48,15 +49,13 @@ std::string Throw::RandomString(size_t length) {
  * \ingroup StringsManipulation
  * \brief Splits string at delimiters and returns vector of strings.
  *
- * Solution found
- * <a href="https://www.fluentcpp.com/2017/04/21/">here</a>.
+ * Empty token after the trailing delimiter is not returned. Use
+ * Throw::SplitView to avoid copying of the tokens.
  */
 std::vector<std::string> Throw::SplitString(const std::string& s,
                                             char delimiter) {
   std::vector<std::string> tokens;
-  std::string token;
-  std::istringstream tokenStream(s);
-  while (std::getline(tokenStream, token, delimiter)) {
+  for (std::string_view token : SplitView(s, delimiter)) {
     tokens.emplace_back(token);
   }
 
@@ -0,0 +1,126 @@
+/**
+ * \file ThrowStringPool.cxx
+ * \brief Implementation of StringPool and InternedString.
+ */
+
+
+// std
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Pooled empty string, shared by all default constructed handles.
+ */
+static const std::string* EmptyString() {
+  static const std::string empty;
+
+  return &empty;
+}
+
+/**
+ * \brief Get pooled copy of the string.
+ *
+ * Lookups of already pooled strings take shared lock only. Pooled strings are
+ * never released.
+ *
+ * \param str string to be interned.
+ */
+Throw::InternedString Throw::StringPool::intern(std::string_view str) {
+  static std::shared_mutex poolMutex;
+  static std::deque<std::string> storage;
+  static std::unordered_map<std::string_view, const std::string*> index;
+
+  InternedString handle;
+  if (str.empty()) {
+    return handle;
+  }
+
+  {
+    std::shared_lock<std::shared_mutex> lock(poolMutex);
+    auto itr = index.find(str);
+    if (itr != index.end()) {
+      handle.ptr = itr->second;
+      return handle;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(poolMutex);
+  auto itr = index.find(str);
+  if (itr != index.end()) {
+    handle.ptr = itr->second;
+    return handle;
+  }
+
+  // Deque keeps the pooled strings in place when it grows
+  storage.emplace_back(str);
+  handle.ptr = &storage.back();
+  index.emplace(std::string_view(storage.back()), handle.ptr);
+
+  return handle;
+}
+
+/**
+ * \brief Default constructor of InternedString, holds empty string.
+ */
+Throw::InternedString::InternedString() {
+  ptr = EmptyString();
+}
+
+/**
+ * \brief Intern the string.
+ */
+Throw::InternedString::InternedString(std::string_view str) {
+  ptr = StringPool::intern(str).ptr;
+}
+
+/**
+ * \brief Get the pooled string.
+ */
+const std::string& Throw::InternedString::str() const {
+
+  return *ptr;
+}
+
+/**
+ * \brief Get the pooled string as C string.
+ */
+const char* Throw::InternedString::c_str() const {
+
+  return ptr->c_str();
+}
+
+/**
+ * \brief Returns true if the pooled strings are the same.
+ *
+ * Compares only the handles.
+ */
+bool Throw::InternedString::operator==(const InternedString& other) const {
+
+  return ptr == other.ptr;
+}
+
+/**
+ * \brief Returns true if the pooled strings differ.
+ *
+ * Compares only the handles.
+ */
+bool Throw::InternedString::operator!=(const InternedString& other) const {
+
+  return ptr != other.ptr;
+}
+
+/**
+ * \brief Hash of the handle.
+ */
+size_t Throw::InternedString::hash() const {
+
+  return std::hash<const std::string*>()(ptr);
+}
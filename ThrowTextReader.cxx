@@ -0,0 +1,489 @@
+/**
+ * \file ThrowTextReader.cxx
+ * \brief Implementation of TextReader.
+ */
+
+
+// std
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <charconv>
+#include <cstring>
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+// Root
+#include <TH1.h>
+#include <TH2.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Nominal size of the chunk processed by one thread at a time.
+ */
+static const size_t kChunkSize = 16 << 20;
+
+/**
+ * \brief Maximal number of lines in front of the data.
+ */
+static const size_t kMaxHeaderLines = 64;
+
+/**
+ * \brief Column index of a fill without weight.
+ */
+static const size_t kNoColumn = static_cast<size_t>(-1);
+
+/**
+ * \brief Strip spaces and carriage return from both ends of the field.
+ */
+static std::string_view TrimField(std::string_view field) {
+  while (!field.empty() && (field.front() == ' ' || field.front() == '\r')) {
+    field.remove_prefix(1);
+  }
+  while (!field.empty() && (field.back() == ' ' || field.back() == '\r')) {
+    field.remove_suffix(1);
+  }
+
+  return field;
+}
+
+/**
+ * \brief Parse the whole field as a number.
+ *
+ * \return false if the field is not a number.
+ */
+static bool ParseField(std::string_view field, double& value) {
+  field = TrimField(field);
+  if (!field.empty() && field.front() == '+') {
+    field.remove_prefix(1);
+  }
+  if (field.empty()) {
+    return false;
+  }
+  const char* end = field.data() + field.size();
+  auto result = std::from_chars(field.data(), end, value);
+
+  return result.ec == std::errc() && result.ptr == end;
+}
+
+/**
+ * \brief Get start of the line following the position.
+ */
+static size_t NextLine(const char* base, size_t pos, size_t size) {
+  const void* newline = memchr(base + pos, '\n', size - pos);
+  if (!newline) {
+    return size;
+  }
+
+  return static_cast<const char*>(newline) - base + 1;
+}
+
+/**
+ * \brief Get start of the first line starting at or after the position.
+ */
+static size_t AlignToLine(const char* base, size_t pos, size_t begin,
+                          size_t size) {
+  if (pos <= begin) {
+    return begin;
+  }
+  if (pos >= size) {
+    return size;
+  }
+
+  return NextLine(base, pos - 1, size);
+}
+
+/**
+ * \brief Map the file into memory and find the header.
+ *
+ * Columns are separated by tabulators.
+ *
+ * \param filePath location of the file.
+ */
+Throw::TextReader::TextReader(const std::string& filePath) :
+    TextReader(filePath, "TSV") {
+}
+
+/**
+ * \brief Map the file into memory and find the header.
+ *
+ * Data start at the first line starting with a number, the line before it
+ * gives names of the columns. Earlier lines, like the name written by
+ * PrintHist, are skipped. Without a header the columns are named by their
+ * index, starting with "0".
+ *
+ * \param filePath location of the file.
+ * \param dialect "TSV" or "CSV".
+ */
+Throw::TextReader::TextReader(const std::string& filePath,
+                              const std::string& dialect) {
+  mapping = nullptr;
+  mappingSize = 0;
+  dataBegin = 0;
+  nRows = 0;
+  nBadRows = 0;
+  if (dialect.compare("TSV") == 0) {
+    separator = '\t';
+  } else if (dialect.compare("CSV") == 0) {
+    separator = ',';
+  } else {
+    throw Exception("Throw::TextReader", "Unknown text dialect");
+  }
+
+  int fd = open(filePath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw Exception("Throw::TextReader", "Can't open input file");
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0) {
+    ::close(fd);
+    throw Exception("Throw::TextReader", "Can't stat input file");
+  }
+  mappingSize = fileStat.st_size;
+  if (mappingSize == 0) {
+    ::close(fd);
+    return;
+  }
+
+  mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    mapping = nullptr;
+    throw Exception("Throw::TextReader", "Can't map input file");
+  }
+  madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+
+  const char* base = static_cast<const char*>(mapping);
+  std::string_view header;
+  size_t pos = 0;
+  for (size_t i = 0; pos < mappingSize; ++i) {
+    if (i >= kMaxHeaderLines) {
+      munmap(mapping, mappingSize);
+      throw Exception("Throw::TextReader", "Can't find numeric data");
+    }
+    size_t next = NextLine(base, pos, mappingSize);
+    std::string_view line(base + pos, next - pos);
+    if (!line.empty() && line.back() == '\n') {
+      line.remove_suffix(1);
+    }
+    double value;
+    if (ParseField(line.substr(0, line.find(separator)), value)) {
+      break;
+    }
+    if (!TrimField(line).empty()) {
+      header = line;
+    }
+    pos = next;
+  }
+  dataBegin = pos;
+
+  if (!header.empty()) {
+    for (std::string_view name : SplitView(header, separator)) {
+      columnNameVec.emplace_back(TrimField(name));
+    }
+  } else if (dataBegin < mappingSize) {
+    size_t next = NextLine(base, dataBegin, mappingSize);
+    std::string_view line(base + dataBegin, next - dataBegin);
+    size_t nColumns = 1;
+    for (char character : TrimField(line.substr(0, line.find('\n')))) {
+      if (character == separator) {
+        ++nColumns;
+      }
+    }
+    for (size_t i = 0; i < nColumns; ++i) {
+      columnNameVec.emplace_back(std::to_string(i));
+    }
+  }
+}
+
+/**
+ * \brief Unmap the file.
+ */
+Throw::TextReader::~TextReader() {
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+}
+
+/**
+ * \brief Get names of the columns.
+ */
+std::vector<std::string> Throw::TextReader::getColumnNames() {
+
+  return columnNameVec;
+}
+
+/**
+ * \brief Get index of the named column.
+ */
+size_t Throw::TextReader::getColumnIndex(const std::string& name) {
+  for (size_t i = 0; i < columnNameVec.size(); ++i) {
+    if (columnNameVec.at(i).compare(name) == 0) {
+      return i;
+    }
+  }
+
+  throw Exception("Throw::TextReader", "Column not found");
+}
+
+/**
+ * \brief Fill histogram with the column at the next run.
+ *
+ * \param hist histogram owned by the caller, its content is kept.
+ * \param xColumn name of the column.
+ */
+void Throw::TextReader::fill1D(TH1* hist, const std::string& xColumn) {
+  if (!hist) {
+    throw Exception("Throw::TextReader::fill1D", "Null TH1* provided");
+  }
+
+  fillVec.push_back({hist, false, getColumnIndex(xColumn), kNoColumn,
+                     kNoColumn});
+}
+
+/**
+ * \brief Fill histogram with the weighted column at the next run.
+ *
+ * \param hist histogram owned by the caller, its content is kept.
+ * \param xColumn name of the column.
+ * \param weightColumn name of the column with weights.
+ */
+void Throw::TextReader::fill1D(TH1* hist,
+                               const std::string& xColumn,
+                               const std::string& weightColumn) {
+  if (!hist) {
+    throw Exception("Throw::TextReader::fill1D", "Null TH1* provided");
+  }
+
+  fillVec.push_back({hist, false, getColumnIndex(xColumn), kNoColumn,
+                     getColumnIndex(weightColumn)});
+}
+
+/**
+ * \brief Fill 2D histogram with the pair of columns at the next run.
+ *
+ * \param hist histogram owned by the caller, its content is kept.
+ * \param xColumn name of the column on the x axis.
+ * \param yColumn name of the column on the y axis.
+ */
+void Throw::TextReader::fill2D(TH2* hist,
+                               const std::string& xColumn,
+                               const std::string& yColumn) {
+  if (!hist) {
+    throw Exception("Throw::TextReader::fill2D", "Null TH2* provided");
+  }
+
+  fillVec.push_back({hist, true, getColumnIndex(xColumn),
+                     getColumnIndex(yColumn), kNoColumn});
+}
+
+/**
+ * \brief Fill 2D histogram with the pair of weighted columns at the next run.
+ *
+ * \param hist histogram owned by the caller, its content is kept.
+ * \param xColumn name of the column on the x axis.
+ * \param yColumn name of the column on the y axis.
+ * \param weightColumn name of the column with weights.
+ */
+void Throw::TextReader::fill2D(TH2* hist,
+                               const std::string& xColumn,
+                               const std::string& yColumn,
+                               const std::string& weightColumn) {
+  if (!hist) {
+    throw Exception("Throw::TextReader::fill2D", "Null TH2* provided");
+  }
+
+  fillVec.push_back({hist, true, getColumnIndex(xColumn),
+                     getColumnIndex(yColumn), getColumnIndex(weightColumn)});
+}
+
+/**
+ * \brief Read the file and fill the histograms, uses one thread per hardware
+ * core.
+ */
+void Throw::TextReader::run() {
+  run(std::thread::hardware_concurrency());
+}
+
+/**
+ * \brief Read the file once and fill all the histograms.
+ *
+ * Only the columns used by the fills are parsed. Rows with a missing or
+ * malformed used column are skipped, see getNbadRows(). Pages of the file
+ * are released as soon as their chunk is processed. The list of fills is
+ * cleared afterwards.
+ *
+ * \param nThreads number of threads.
+ */
+void Throw::TextReader::run(size_t nThreads) {
+  THROW_TRACE("Throw::TextReader::run");
+  nRows = 0;
+  nBadRows = 0;
+  if (fillVec.empty() || dataBegin >= mappingSize) {
+    fillVec.clear();
+    return;
+  }
+
+  // Only the used columns are parsed, the row ends after the last of them
+  std::vector<char> usedVec;
+  auto useColumn = [&](size_t column) {
+    if (column == kNoColumn) {
+      return;
+    }
+    if (column >= usedVec.size()) {
+      usedVec.resize(column + 1, 0);
+    }
+    usedVec[column] = 1;
+  };
+  for (auto &fill : fillVec) {
+    useColumn(fill.xColumn);
+    useColumn(fill.yColumn);
+    useColumn(fill.weightColumn);
+  }
+  const size_t nColumns = usedVec.size();
+
+  size_t nChunks = (mappingSize - dataBegin + kChunkSize - 1) / kChunkSize;
+  if (nThreads < 1) {
+    nThreads = 1;
+  }
+  if (nThreads > nChunks) {
+    nThreads = nChunks;
+  }
+
+  // Histograms are cloned on this thread, ROOT isn't thread safe there
+  std::vector<std::vector<TH1*>> histVec(nThreads);
+  for (auto &threadHists : histVec) {
+    for (auto &fill : fillVec) {
+      TH1* hist = dynamic_cast<TH1*>(fill.hist->Clone());
+      hist->SetDirectory(nullptr);
+      hist->Reset();
+      threadHists.emplace_back(hist);
+    }
+  }
+
+  const char* base = static_cast<const char*>(mapping);
+  const long pageSize = sysconf(_SC_PAGESIZE);
+  std::atomic<size_t> nextChunk(0);
+  std::atomic<uint64_t> rowCount(0);
+  std::atomic<uint64_t> badRowCount(0);
+  auto worker = [&](std::vector<TH1*>& threadHists) {
+    std::vector<double> values(nColumns);
+    uint64_t nThreadRows = 0;
+    uint64_t nThreadBadRows = 0;
+
+    for (size_t i = nextChunk++; i < nChunks; i = nextChunk++) {
+      size_t begin = AlignToLine(base, dataBegin + i * kChunkSize,
+                                 dataBegin, mappingSize);
+      size_t end = AlignToLine(base, dataBegin + (i + 1) * kChunkSize,
+                               dataBegin, mappingSize);
+
+      for (size_t pos = begin; pos < end;) {
+        size_t next = NextLine(base, pos, end);
+        std::string_view line(base + pos, next - pos);
+        pos = next;
+        if (!line.empty() && line.back() == '\n') {
+          line.remove_suffix(1);
+        }
+        if (TrimField(line).empty()) {
+          continue;
+        }
+
+        bool good = true;
+        size_t column = 0;
+        size_t fieldBegin = 0;
+        while (column < nColumns) {
+          size_t fieldEnd = line.find(separator, fieldBegin);
+          if (usedVec[column]) {
+            good = ParseField(line.substr(fieldBegin, fieldEnd - fieldBegin),
+                              values[column]);
+            if (!good) {
+              break;
+            }
+          }
+          ++column;
+          if (fieldEnd == std::string_view::npos) {
+            break;
+          }
+          fieldBegin = fieldEnd + 1;
+        }
+        if (!good || column < nColumns) {
+          ++nThreadBadRows;
+          continue;
+        }
+
+        ++nThreadRows;
+        for (size_t j = 0; j < fillVec.size(); ++j) {
+          const Fill& fill = fillVec[j];
+          double weight = 1.;
+          if (fill.weightColumn != kNoColumn) {
+            weight = values[fill.weightColumn];
+          }
+          if (fill.is2D) {
+            static_cast<TH2*>(threadHists[j])->Fill(values[fill.xColumn],
+                                                    values[fill.yColumn],
+                                                    weight);
+          } else {
+            threadHists[j]->Fill(values[fill.xColumn], weight);
+          }
+        }
+      }
+
+      // Processed pages are dropped to keep the resident memory flat
+      size_t pageBegin = (begin + pageSize - 1) / pageSize * pageSize;
+      size_t pageEnd = end / pageSize * pageSize;
+      if (pageEnd > pageBegin) {
+        madvise(const_cast<char*>(base) + pageBegin, pageEnd - pageBegin,
+                MADV_DONTNEED);
+      }
+    }
+
+    rowCount += nThreadRows;
+    badRowCount += nThreadBadRows;
+  };
+
+  std::vector<std::thread> threadVec;
+  for (size_t i = 0; i < nThreads; ++i) {
+    threadVec.emplace_back(worker, std::ref(histVec[i]));
+  }
+  for (auto &thread : threadVec) {
+    thread.join();
+  }
+
+  for (auto &threadHists : histVec) {
+    for (size_t j = 0; j < fillVec.size(); ++j) {
+      fillVec[j].hist->Add(threadHists[j]);
+      delete threadHists[j];
+    }
+  }
+  fillVec.clear();
+
+  nRows = rowCount;
+  nBadRows = badRowCount;
+  if (nBadRows > 0) {
+    THROW_LOG_WARNING("Throw::TextReader -- Skipped malformed rows: " +
+                      std::to_string(nBadRows));
+  }
+}
+
+/**
+ * \brief Get number of rows filled by the last run.
+ */
+uint64_t Throw::TextReader::getNrows() {
+
+  return nRows;
+}
+
+/**
+ * \brief Get number of rows skipped by the last run.
+ */
+uint64_t Throw::TextReader::getNbadRows() {
+
+  return nBadRows;
+}
@@ -6,37 +6,88 @@
 
 // std
 #include <string>
-#include <vector>
 #include <chrono>
+#include <ctime>
 // Throw
 #include "Throw.h"
 
 
+/**
+ * \brief Three characters long month shortcuts.
+ */
+static const char kMonthNames[12][4] = {"Jan", "Feb", "Mar", "Apr",
+                                        "May", "Jun", "Jul", "Aug",
+                                        "Sep", "Oct", "Nov", "Dec"};
+
+/**
+ * \brief Write number as two digits.
+ */
+static char* WriteTwoDigits(char* buffer, int number) {
+  buffer[0] = '0' + number / 10 % 10;
+  buffer[1] = '0' + number % 10;
+
+  return buffer + 2;
+}
+
+/**
+ * \brief Write date as "YYYY_Mon_DD".
+ *
+ * \return number of written characters, 0 if the buffer is too small.
+ */
+static size_t WriteDate(const tm& date, char* buffer, size_t size) {
+  // Four digit year, month name, day, separators and null character
+  if (size < 12) {
+    return 0;
+  }
+
+  char* pos = buffer;
+  int year = date.tm_year + 1900;
+  pos = WriteTwoDigits(pos, year / 100);
+  pos = WriteTwoDigits(pos, year % 100);
+  *pos++ = '_';
+  for (size_t i = 0; i < 3; ++i) {
+    *pos++ = kMonthNames[date.tm_mon][i];
+  }
+  *pos++ = '_';
+  pos = WriteTwoDigits(pos, date.tm_mday);
+  *pos = '\0';
+
+  return pos - buffer;
+}
+
 /**
  * \ingroup Time
  * \brief Get current time.
+ *
+ * The clock is read only once.
  */
 tm Throw::GetCurrentTime() {
-  typedef std::chrono::duration<int,
-                                std::ratio_multiply<std::chrono::hours::period,
-                                std::ratio<24>>::type> days;
+  time_t tt = std::chrono::system_clock::to_time_t(
+      std::chrono::system_clock::now());
 
-  std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-  std::chrono::system_clock::duration tp = now.time_since_epoch();
-
-  days d = std::chrono::duration_cast<days>(tp);
-  tp -= d;
-  std::chrono::hours h = std::chrono::duration_cast<std::chrono::hours>(tp);
-  tp -= h;
-  std::chrono::minutes m = std::chrono::duration_cast<std::chrono::minutes>(tp);
-  tp -= m;
-  std::chrono::seconds s = std::chrono::duration_cast<std::chrono::seconds>(tp);
-  tp -= s;
+  return GetLocalTime(tt);
+}
 
-  time_t tt = std::chrono::system_clock::to_time_t(now);
-  tm local_tm = *localtime(&tt);
+/**
+ * \ingroup Time
+ * \brief Convert time to the local time.
+ *
+ * Thread-safe, every thread caches the conversion for the last second.
+ *
+ * \param tt time to be converted.
+ */
+tm Throw::GetLocalTime(time_t tt) {
+  static const bool tzInitialized = (tzset(), true);
+  (void) tzInitialized;
+
+  thread_local time_t cachedSecond = -1;
+  thread_local tm cachedTime;
+  if (tt != cachedSecond) {
+    localtime_r(&tt, &cachedTime);
+    cachedSecond = tt;
+  }
 
-  return local_tm;
+  return cachedTime;
 }
 
 /**
@@ -48,21 +99,11 @@ tm Throw::GetCurrentTime() {
  * Returns three characters long month shortcut.
  */
 std::string Throw::MonthNumToName(int month) {
-  std::vector<std::string> months;
-  months.emplace_back("Jan");
-  months.emplace_back("Feb");
-  months.emplace_back("Mar");
-  months.emplace_back("Apr");
-  months.emplace_back("May");
-  months.emplace_back("Jun");
-  months.emplace_back("Jul");
-  months.emplace_back("Aug");
-  months.emplace_back("Sep");
-  months.emplace_back("Oct");
-  months.emplace_back("Nov");
-  months.emplace_back("Dec");
+  if (month < 0 || month > 11) {
+    throw Exception("Throw::MonthNumToName", "Out of range");
+  }
 
-  return months.at(month);
+  return kMonthNames[month];
 }
 
 /**
@@ -162,19 +203,10 @@ std::string Throw::GetCurrentSecond() {
  * \brief Get current time and date as a string.
  */
 std::string Throw::Now() {
-  std::string now = GetCurrentHour();
-  now += ":";
-  now += GetCurrentMinute();
-  now += ":";
-  now += GetCurrentSecond();
-  now += " ";
-  now += GetCurrentDay();
-  now += " ";
-  now += GetCurrentMonth();
-  now += " ";
-  now += GetCurrentYear();
+  char buffer[32];
+  size_t length = FormatNow(buffer, sizeof(buffer));
 
-  return now;
+  return std::string(buffer, length);
 }
 
 /**
@@ -182,13 +214,10 @@ std::string Throw::Now() {
  * \brief Get current date as a string.
  */
 std::string Throw::Today() {
-  std::string today = GetCurrentYear();
-  today += "_";
-  today += GetCurrentMonth();
-  today += "_";
-  today += GetCurrentDay();
+  char buffer[16];
+  size_t length = FormatToday(buffer, sizeof(buffer));
 
-  return today;
+  return std::string(buffer, length);
 }
 
 /**
@@ -196,52 +225,99 @@ std::string Throw::Today() {
  * \brief Get date of a previous day as a string.
  */
 std::string Throw::Yesterday() {
-  tm now = GetCurrentTime();
-  int year = now.tm_year + 1900;
-  int month = now.tm_mon + 1;
-  int day = now.tm_mday;
+  time_t tt = std::chrono::system_clock::to_time_t(
+      std::chrono::system_clock::now());
 
-  if (day == 1) {
-    if (month == 1) {
-      year = year - 1;
-      month = 12;
-      day = 31;
-    } else if (month == 2) {
-      month = 1;
-      day = 31;
-    } else if (month == 3) {
-      month = 2;
-      if (year % 4 == 0) {
-        day = 29;
-      } else {
-        day = 28;
-      }
-    } else if (month == 4 ||
-               month == 6 ||
-               month == 8 ||
-               month == 9 ||
-               month == 11) {
-      month -= 1;
-      day = 31;
-    } else if (month == 5 ||
-               month == 7 ||
-               month == 10 ||
-               month == 12) {
-      month -= 1;
-      day = 30;
-    }
-  } else {
-    day -= 1;
+  return Yesterday(tt);
+}
+
+/**
+ * \ingroup Time
+ * \brief Get date of the day before the time as a string.
+ *
+ * \param tt time in the day after the wanted date.
+ */
+std::string Throw::Yesterday(time_t tt) {
+  tm date = GetLocalTime(tt);
+  // Noon is safe from daylight saving time shifts
+  date.tm_mday -= 1;
+  date.tm_hour = 12;
+  date.tm_min = 0;
+  date.tm_sec = 0;
+  date.tm_isdst = -1;
+  mktime(&date);
+
+  char buffer[16];
+  size_t length = WriteDate(date, buffer, sizeof(buffer));
+
+  return std::string(buffer, length);
+}
+
+/**
+ * \ingroup Time
+ * \brief Format time as "HH:MM:SS DD Mon YYYY" into the buffer.
+ *
+ * Doesn't allocate.
+ *
+ * \param tt time to be formatted.
+ * \param buffer output buffer, null terminated.
+ * \param size size of the buffer, at least 21 characters.
+ *
+ * \return number of written characters, 0 if the buffer is too small.
+ */
+size_t Throw::FormatTime(time_t tt, char* buffer, size_t size) {
+  if (size < 21) {
+    return 0;
   }
 
-  std::string today = std::to_string(year);
-  today += "_";
-  today += MonthNumToName(month - 1);
-  today += "_";
-  if (day < 10) {
-    today += "0";
+  tm date = GetLocalTime(tt);
+  char* pos = buffer;
+  pos = WriteTwoDigits(pos, date.tm_hour);
+  *pos++ = ':';
+  pos = WriteTwoDigits(pos, date.tm_min);
+  *pos++ = ':';
+  pos = WriteTwoDigits(pos, date.tm_sec);
+  *pos++ = ' ';
+  pos = WriteTwoDigits(pos, date.tm_mday);
+  *pos++ = ' ';
+  for (size_t i = 0; i < 3; ++i) {
+    *pos++ = kMonthNames[date.tm_mon][i];
   }
-  today += std::to_string(day);
+  *pos++ = ' ';
+  int year = date.tm_year + 1900;
+  pos = WriteTwoDigits(pos, year / 100);
+  pos = WriteTwoDigits(pos, year % 100);
+  *pos = '\0';
+
+  return pos - buffer;
+}
+
+/**
+ * \ingroup Time
+ * \brief Format current time as "HH:MM:SS DD Mon YYYY" into the buffer.
+ *
+ * \param buffer output buffer, null terminated.
+ * \param size size of the buffer, at least 21 characters.
+ *
+ * \return number of written characters, 0 if the buffer is too small.
+ */
+size_t Throw::FormatNow(char* buffer, size_t size) {
+  time_t tt = std::chrono::system_clock::to_time_t(
+      std::chrono::system_clock::now());
+
+  return FormatTime(tt, buffer, size);
+}
+
+/**
+ * \ingroup Time
+ * \brief Format current date as "YYYY_Mon_DD" into the buffer.
+ *
+ * \param buffer output buffer, null terminated.
+ * \param size size of the buffer, at least 12 characters.
+ *
+ * \return number of written characters, 0 if the buffer is too small.
+ */
+size_t Throw::FormatToday(char* buffer, size_t size) {
 
-  return today;
+  return WriteDate(GetCurrentTime(), buffer, size);
 }
@@ -0,0 +1,330 @@
+/**
+ * \file ThrowTrace.cxx
+ * \brief Implementation of the trace span recorder.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <chrono>
+// POSIX
+#include <unistd.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Default number of spans kept per thread.
+ */
+static const size_t kDefaultCapacity = 1 << 16;
+
+/**
+ * \brief Recorded span.
+ *
+ * Fields are atomic so the spans can be exported while threads record. The
+ * sequence is 2 * index + 1 while the span with the index is written and
+ * 2 * index + 2 once it's complete.
+ */
+struct TraceEvent {
+  std::atomic<uint64_t> sequence;
+  std::atomic<const char*> name;
+  std::atomic<uint64_t> start;
+  std::atomic<uint64_t> duration;
+};
+
+/**
+ * \brief Ring buffer of spans of one thread, written only by the thread.
+ *
+ * Rings of exited threads keep their spans until they are reused by a new
+ * thread. Thread index, active flag and cleared count are changed only with
+ * the ring mutex held.
+ */
+struct TraceRing {
+  size_t threadIndex;
+  size_t capacity;
+  bool active;
+  std::unique_ptr<TraceEvent[]> eventVec;
+  std::atomic<uint64_t> nRecorded;
+  std::atomic<uint64_t> nCleared;
+};
+
+/**
+ * \brief Recorder state.
+ */
+static std::atomic<bool> traceEnabled(false);
+static std::atomic<size_t> traceCapacity(kDefaultCapacity);
+static const std::chrono::steady_clock::time_point traceEpoch =
+    std::chrono::steady_clock::now();
+static std::mutex ringMutex;
+static std::vector<std::shared_ptr<TraceRing>> ringVec;
+static size_t nTraceThreads = 0;
+
+/**
+ * \brief Holds ring buffer of the current thread, frees it for reuse when the
+ * thread exits.
+ */
+struct TraceRingOwner {
+  TraceRing* ring = nullptr;
+
+  ~TraceRingOwner() {
+    if (ring) {
+      std::lock_guard<std::mutex> lock(ringMutex);
+      ring->active = false;
+    }
+  }
+};
+
+/**
+ * \brief Get ring buffer of the current thread, registers the thread at the
+ * first call.
+ *
+ * Ring of an exited thread with the current capacity is reused, its spans are
+ * dropped. Free rings with another capacity are released.
+ */
+static TraceRing& GetThreadRing() {
+  thread_local TraceRingOwner owner;
+  if (!owner.ring) {
+    size_t capacity = traceCapacity.load();
+
+    std::lock_guard<std::mutex> lock(ringMutex);
+    for (auto itr = ringVec.begin(); itr != ringVec.end();) {
+      TraceRing& ring = **itr;
+      if (ring.active) {
+        ++itr;
+      } else if (ring.capacity != capacity) {
+        itr = ringVec.erase(itr);
+      } else {
+        owner.ring = &ring;
+        break;
+      }
+    }
+
+    if (!owner.ring) {
+      auto ring = std::make_shared<TraceRing>();
+      ring->capacity = capacity;
+      ring->eventVec.reset(new TraceEvent[ring->capacity]);
+      for (size_t i = 0; i < ring->capacity; ++i) {
+        ring->eventVec[i].sequence.store(0);
+      }
+      ring->nRecorded.store(0);
+      ringVec.emplace_back(ring);
+      owner.ring = ring.get();
+    }
+    owner.ring->threadIndex = nTraceThreads++;
+    owner.ring->active = true;
+    owner.ring->nCleared.store(owner.ring->nRecorded.load());
+  }
+
+  return *owner.ring;
+}
+
+/**
+ * \brief Get nanoseconds since the start of the recording.
+ */
+static uint64_t GetTraceTime(std::chrono::steady_clock::time_point time) {
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      time - traceEpoch).count();
+}
+
+/**
+ * \brief Write string as JSON string literal.
+ */
+static void WriteJsonString(Throw::BufferedWriter& writer, const char* str) {
+  writer.write('"');
+  for (const char* pos = str; *pos; ++pos) {
+    if (*pos == '"' || *pos == '\\') {
+      writer.write('\\');
+      writer.write(*pos);
+    } else if ((unsigned char) *pos < 0x20) {
+      writer.write(' ');
+    } else {
+      writer.write(*pos);
+    }
+  }
+  writer.write('"');
+}
+
+/**
+ * \brief Start the span.
+ *
+ * \param spanName name of the span, has to stay valid, e.g. string literal.
+ */
+Throw::TraceSpan::TraceSpan(const char* spanName) {
+  name = nullptr;
+  if (!traceEnabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  name = spanName;
+  start = std::chrono::steady_clock::now();
+}
+
+/**
+ * \brief Start the span.
+ *
+ * The name is interned in the StringPool.
+ *
+ * \param spanName name of the span.
+ */
+Throw::TraceSpan::TraceSpan(const std::string& spanName) {
+  name = nullptr;
+  if (!traceEnabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  name = StringPool::intern(spanName).c_str();
+  start = std::chrono::steady_clock::now();
+}
+
+/**
+ * \brief Finish the span and record it.
+ */
+Throw::TraceSpan::~TraceSpan() {
+  if (!name) {
+    return;
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  TraceRing& ring = GetThreadRing();
+  uint64_t index = ring.nRecorded.load(std::memory_order_relaxed);
+  TraceEvent& event = ring.eventVec[index % ring.capacity];
+  event.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  event.name.store(name, std::memory_order_relaxed);
+  event.start.store(GetTraceTime(start), std::memory_order_relaxed);
+  event.duration.store(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          end - start).count(),
+      std::memory_order_relaxed);
+  event.sequence.store(2 * index + 2, std::memory_order_release);
+  ring.nRecorded.store(index + 1, std::memory_order_release);
+}
+
+/**
+ * \brief Start recording spans.
+ */
+void Throw::TraceRecorder::enable() {
+  traceEnabled.store(true);
+}
+
+/**
+ * \brief Start recording spans.
+ *
+ * \param capacity number of latest spans kept per thread, applies to threads
+ * which didn't record any span yet.
+ */
+void Throw::TraceRecorder::enable(size_t capacity) {
+  if (capacity < 1) {
+    throw Exception("Throw::TraceRecorder::enable",
+                    "Capacity has to be positive");
+  }
+  traceCapacity.store(capacity);
+  traceEnabled.store(true);
+}
+
+/**
+ * \brief Stop recording spans, the recorded spans are kept.
+ */
+void Throw::TraceRecorder::disable() {
+  traceEnabled.store(false);
+}
+
+/**
+ * \brief Returns true if the spans are recorded.
+ */
+bool Throw::TraceRecorder::isEnabled() {
+
+  return traceEnabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Forget the recorded spans.
+ *
+ * Spans finished while clearing might survive. Rings of exited threads are
+ * released.
+ */
+void Throw::TraceRecorder::clear() {
+  std::lock_guard<std::mutex> lock(ringMutex);
+  for (auto itr = ringVec.begin(); itr != ringVec.end();) {
+    if (!(*itr)->active) {
+      itr = ringVec.erase(itr);
+      continue;
+    }
+    (*itr)->nCleared.store((*itr)->nRecorded.load());
+    ++itr;
+  }
+}
+
+/**
+ * \brief Write recorded spans as Chrome trace-event JSON.
+ *
+ * Spans recorded during the export might be skipped, spans overwritten while
+ * they are read are always skipped.
+ *
+ * \param filePath path to the output JSON file.
+ *
+ * \return true if the file was written.
+ */
+bool Throw::TraceRecorder::write(const std::string& filePath) {
+  BufferedWriter writer(filePath);
+  if (!writer.isGood()) {
+    return false;
+  }
+
+  long long pid = getpid();
+  writer.write("{\"traceEvents\":[\n");
+  bool first = true;
+
+  std::lock_guard<std::mutex> lock(ringMutex);
+  for (auto &ring : ringVec) {
+    long long tid = ring->threadIndex;
+    if (!first) {
+      writer.write(",\n");
+    }
+    first = false;
+    writer.write("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":");
+    writer.write(pid);
+    writer.write(",\"tid\":");
+    writer.write(tid);
+    writer.write(",\"args\":{\"name\":\"Thread ");
+    writer.write(tid);
+    writer.write("\"}}");
+
+    uint64_t nRecorded = ring->nRecorded.load(std::memory_order_acquire);
+    uint64_t begin = ring->nCleared.load();
+    if (nRecorded > ring->capacity && nRecorded - ring->capacity > begin) {
+      begin = nRecorded - ring->capacity;
+    }
+    for (uint64_t i = begin; i < nRecorded; ++i) {
+      TraceEvent& event = ring->eventVec[i % ring->capacity];
+      uint64_t sequence = event.sequence.load(std::memory_order_acquire);
+      const char* name = event.name.load(std::memory_order_relaxed);
+      uint64_t start = event.start.load(std::memory_order_relaxed);
+      uint64_t duration = event.duration.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // Span was overwritten by a newer one while being read
+      if (sequence != 2 * i + 2 ||
+          event.sequence.load(std::memory_order_relaxed) != sequence) {
+        continue;
+      }
+
+      writer.write(",\n{\"name\":");
+      WriteJsonString(writer, name);
+      writer.write(",\"cat\":\"Throw\",\"ph\":\"X\",\"pid\":");
+      writer.write(pid);
+      writer.write(",\"tid\":");
+      writer.write(tid);
+      writer.write(",\"ts\":");
+      writer.write(start / 1e3);
+      writer.write(",\"dur\":");
+      writer.write(duration / 1e3);
+      writer.write('}');
+    }
+  }
+  writer.write("\n],\"displayTimeUnit\":\"ms\"}\n");
+
+  return writer.close();
+}
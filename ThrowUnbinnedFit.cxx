@@ -0,0 +1,539 @@
+/**
+ * \file ThrowUnbinnedFit.cxx
+ * \brief Implementation of UnbinnedFit.
+ */
+
+
+// std
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include <cmath>
+// Root
+#include <TF1.h>
+#include <Minuit2/FCNBase.h>
+#include <Minuit2/FunctionMinimum.h>
+#include <Minuit2/MnUserParameters.h>
+#include <Minuit2/MnMigrad.h>
+#include <Minuit2/MnHesse.h>
+// Throw
+#include "Throw.h"
+
+
+/**
+ * \brief Number of events passed to the PDF at once.
+ */
+static const size_t kBatchSize = 1024;
+
+/**
+ * \brief Smaller samples don't get another thread.
+ */
+static const size_t kMinEventsPerThread = 1 << 16;
+
+/**
+ * \brief Number of points of the normalization integral, has to be odd.
+ */
+static const size_t kNormPoints = 1025;
+
+/**
+ * \brief Replaces non-positive values of the PDF in the likelihood.
+ */
+static const double kMinPdf = 1e-300;
+
+/**
+ * \brief Returned for parameters with non-positive normalization.
+ */
+static const double kBadNll = 1e30;
+
+/**
+ * \brief Integrate the PDF over the range with the Simpson's rule.
+ */
+static double Integrate(
+    const std::function<void(const double*, size_t,
+                             const double*, double*)>& pdf,
+    const double* params, double xMin, double xMax) {
+  double step = (xMax - xMin) / (kNormPoints - 1);
+  double x[kNormPoints];
+  double values[kNormPoints];
+  for (size_t i = 0; i < kNormPoints; ++i) {
+    x[i] = xMin + i * step;
+  }
+  pdf(x, kNormPoints, params, values);
+
+  double sum = values[0] + values[kNormPoints - 1];
+  for (size_t i = 1; i < kNormPoints - 1; ++i) {
+    sum += (i % 2 ? 4. : 2.) * values[i];
+  }
+
+  return sum * step / 3.;
+}
+
+/**
+ * \brief Negative log-likelihood as seen by Minuit2.
+ */
+class NllFunction : public ROOT::Minuit2::FCNBase {
+  public:
+    std::function<double(const std::vector<double>&)> nll;
+
+    double operator()(const std::vector<double>& params) const override {
+
+      return nll(params);
+    }
+
+    double Up() const override {
+
+      return .5;
+    }
+};
+
+/**
+ * \brief Pool of threads summing partial results for the same parameters.
+ *
+ * The calling thread computes the first part, the other threads wait for
+ * the next parameters between the calls. The partial sums are added in a
+ * fixed order, the result doesn't depend on the scheduling. Exception thrown
+ * by a part is rethrown on the calling thread once all parts are done.
+ */
+class SumPool {
+  public:
+    SumPool(const std::function<double(const double*, size_t, size_t)>& part,
+            size_t nThreads) {
+      this->part = part;
+      sumVec.assign(nThreads, 0.);
+      params = nullptr;
+      generation = 0;
+      nRunning = 0;
+      stop = false;
+      for (size_t i = 1; i < nThreads; ++i) {
+        threadVec.emplace_back(&SumPool::run, this, i);
+      }
+    }
+
+    ~SumPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+      }
+      start.notify_all();
+      for (auto &thread : threadVec) {
+        thread.join();
+      }
+    }
+
+    double sum(const double* params) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->params = params;
+        nRunning = threadVec.size();
+        ++generation;
+      }
+      start.notify_all();
+      std::exception_ptr callerError;
+      try {
+        sumVec[0] = part(params, 0, sumVec.size());
+      } catch (...) {
+        callerError = std::current_exception();
+      }
+      std::exception_ptr workerError;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return nRunning == 0; });
+        workerError = error;
+        error = nullptr;
+      }
+      if (callerError) {
+        std::rethrow_exception(callerError);
+      }
+      if (workerError) {
+        std::rethrow_exception(workerError);
+      }
+
+      double result = 0.;
+      for (double partSum : sumVec) {
+        result += partSum;
+      }
+
+      return result;
+    }
+
+  private:
+    std::function<double(const double*, size_t, size_t)> part;
+    std::vector<double> sumVec;
+    std::vector<std::thread> threadVec;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+    const double* params;
+    std::exception_ptr error;
+    uint64_t generation;
+    size_t nRunning;
+    bool stop;
+
+    void run(size_t thread) {
+      uint64_t seen = 0;
+      while (true) {
+        const double* current;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          start.wait(lock, [&]() { return stop || generation != seen; });
+          if (stop) {
+            return;
+          }
+          seen = generation;
+          current = params;
+        }
+        std::exception_ptr partError;
+        try {
+          sumVec[thread] = part(current, thread, sumVec.size());
+        } catch (...) {
+          partError = std::current_exception();
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (partError && !error) {
+            error = partError;
+          }
+          if (--nRunning == 0) {
+            done.notify_one();
+          }
+        }
+      }
+    }
+};
+
+/**
+ * \brief Constructor of UnbinnedFit.
+ *
+ * \param name name of the fit, used for the function.
+ * \param pdf PDF evaluated on batches: (x, n, parameters, values).
+ * \param xMin lower edge of the fit range.
+ * \param xMax upper edge of the fit range.
+ * \param nPar number of parameters.
+ */
+Throw::UnbinnedFit::UnbinnedFit(
+    const std::string& name,
+    const std::function<void(const double*, size_t,
+                             const double*, double*)>& pdf,
+    double xMin, double xMax, int nPar) {
+  if (!pdf) {
+    throw Exception("Throw::UnbinnedFit", "Empty PDF provided");
+  }
+  if (!(xMin < xMax) || nPar < 1) {
+    throw Exception("Throw::UnbinnedFit", "Bad range or number of parameters");
+  }
+
+  this->name = name;
+  this->pdf = pdf;
+  this->xMin = xMin;
+  this->xMax = xMax;
+  for (int i = 0; i < nPar; ++i) {
+    parNameVec.emplace_back("p" + std::to_string(i));
+  }
+  parValueVec.assign(nPar, 0.);
+  parErrorVec.assign(nPar, .1);
+  parLowVec.assign(nPar, 0.);
+  parHighVec.assign(nPar, 0.);
+  parFixedVec.assign(nPar, 0);
+  minNll = 0.;
+}
+
+/**
+ * \brief Set fitted events.
+ *
+ * \param events positions of the events, events outside of the range are
+ * dropped.
+ */
+void Throw::UnbinnedFit::setData(const std::vector<double>& events) {
+  setData(events.data(), events.size());
+}
+
+/**
+ * \brief Set fitted events.
+ *
+ * \param events positions of the events, events outside of the range are
+ * dropped.
+ * \param nEvents number of events.
+ */
+void Throw::UnbinnedFit::setData(const double* events, size_t nEvents) {
+  eventVec.clear();
+  eventVec.reserve(nEvents);
+  for (size_t i = 0; i < nEvents; ++i) {
+    if (events[i] >= xMin && events[i] <= xMax) {
+      eventVec.emplace_back(events[i]);
+    }
+  }
+  eventVec.shrink_to_fit();
+}
+
+/**
+ * \brief Check index of the parameter.
+ */
+void Throw::UnbinnedFit::checkParIndex(int i) {
+  if (i < 0 || i >= static_cast<int>(parValueVec.size())) {
+    throw Exception("Throw::UnbinnedFit", "Parameter index out of range");
+  }
+}
+
+/**
+ * \brief Set starting value of the parameter.
+ *
+ * Tenth of the value is used as the initial step.
+ */
+void Throw::UnbinnedFit::setParameter(int i, double value) {
+  checkParIndex(i);
+  parValueVec[i] = value;
+  parErrorVec[i] = value != 0. ? std::abs(value) * .1 : .1;
+}
+
+/**
+ * \brief Set name of the parameter, default is "p0", "p1", ...
+ */
+void Throw::UnbinnedFit::setParName(int i, const std::string& parName) {
+  checkParIndex(i);
+  parNameVec[i] = parName;
+}
+
+/**
+ * \brief Limit the parameter to the interval.
+ */
+void Throw::UnbinnedFit::setParLimits(int i, double low, double high) {
+  checkParIndex(i);
+  if (!(low < high)) {
+    throw Exception("Throw::UnbinnedFit::setParLimits", "Empty interval");
+  }
+  parLowVec[i] = low;
+  parHighVec[i] = high;
+}
+
+/**
+ * \brief Fix the parameter to the value.
+ */
+void Throw::UnbinnedFit::fixParameter(int i, double value) {
+  checkParIndex(i);
+  parValueVec[i] = value;
+  parFixedVec[i] = 1;
+}
+
+/**
+ * \brief Sum of the log of the PDF over a fixed range of batches.
+ *
+ * \param params parameters of the PDF.
+ * \param thread index of the thread, selects the range.
+ * \param nThreads number of threads.
+ */
+double Throw::UnbinnedFit::sumLogPdf(const double* params, size_t thread,
+                                     size_t nThreads) {
+  size_t nBatches = (eventVec.size() + kBatchSize - 1) / kBatchSize;
+  size_t batchEnd = nBatches * (thread + 1) / nThreads;
+  double values[kBatchSize];
+  double sum = 0.;
+  for (size_t i = nBatches * thread / nThreads; i < batchEnd; ++i) {
+    size_t begin = i * kBatchSize;
+    size_t n = std::min(kBatchSize, eventVec.size() - begin);
+    pdf(eventVec.data() + begin, n, params, values);
+
+    double batchSum = 0.;
+    for (size_t j = 0; j < n; ++j) {
+      batchSum += std::log(values[j] > kMinPdf ? values[j] : kMinPdf);
+    }
+    sum += batchSum;
+  }
+
+  return sum;
+}
+
+/**
+ * \brief Compute negative log-likelihood of the events.
+ *
+ * \param params parameters of the PDF.
+ * \param sumLog sum of the log of the PDF over all events.
+ */
+double Throw::UnbinnedFit::computeNll(
+    const std::vector<double>& params,
+    const std::function<double(const double*)>& sumLog) {
+  double norm = Integrate(pdf, params.data(), xMin, xMax);
+  if (!(norm > 0.) || !std::isfinite(norm)) {
+    return kBadNll;
+  }
+
+  return eventVec.size() * std::log(norm) - sumLog(params.data());
+}
+
+/**
+ * \brief Get negative log-likelihood of the events, e.g. for a scan.
+ *
+ * \param params parameters of the PDF.
+ */
+double Throw::UnbinnedFit::getNll(const std::vector<double>& params) {
+  if (params.size() != parValueVec.size()) {
+    throw Exception("Throw::UnbinnedFit::getNll", "Wrong number of parameters");
+  }
+  size_t nThreads = std::thread::hardware_concurrency();
+  nThreads = std::min(nThreads, eventVec.size() / kMinEventsPerThread);
+  nThreads = std::max(nThreads, size_t(1));
+
+  SumPool pool(
+      [this](const double* p, size_t thread, size_t nParts) {
+        return sumLogPdf(p, thread, nParts);
+      }, nThreads);
+
+  return computeNll(params, [&pool](const double* values) {
+    return pool.sum(values);
+  });
+}
+
+/**
+ * \brief Fit the events, uses one thread per hardware core.
+ */
+int Throw::UnbinnedFit::fit() {
+
+  return fit(std::thread::hardware_concurrency());
+}
+
+/**
+ * \brief Minimize negative log-likelihood of the events with Migrad,
+ * errors are computed by Hesse.
+ *
+ * Small samples use fewer threads, a thread gets at least 65536 events. The
+ * threads are started once and reused by every evaluation of the likelihood.
+ *
+ * \param nThreads maximal number of threads.
+ *
+ * \return 0 if the minimum is valid.
+ */
+int Throw::UnbinnedFit::fit(size_t nThreads) {
+  THROW_TRACE("Throw::UnbinnedFit::fit");
+  if (eventVec.empty()) {
+    throw Exception("Throw::UnbinnedFit::fit", "No events in the range");
+  }
+  nThreads = std::min(nThreads, eventVec.size() / kMinEventsPerThread);
+  nThreads = std::max(nThreads, size_t(1));
+
+  // Workers live until the end of the fit, every call of the NLL wakes them
+  SumPool pool(
+      [this](const double* p, size_t thread, size_t nParts) {
+        return sumLogPdf(p, thread, nParts);
+      }, nThreads);
+  NllFunction function;
+  function.nll = [this, &pool](const std::vector<double>& params) {
+    return computeNll(params, [&pool](const double* values) {
+      return pool.sum(values);
+    });
+  };
+
+  ROOT::Minuit2::MnUserParameters parameters;
+  for (size_t i = 0; i < parValueVec.size(); ++i) {
+    parameters.Add(parNameVec[i], parValueVec[i], parErrorVec[i]);
+    if (parLowVec[i] < parHighVec[i]) {
+      parameters.SetLimits(i, parLowVec[i], parHighVec[i]);
+    }
+    if (parFixedVec[i]) {
+      parameters.Fix(i);
+    }
+  }
+
+  ROOT::Minuit2::MnMigrad migrad(function, parameters);
+  ROOT::Minuit2::FunctionMinimum minimum = migrad();
+  if (minimum.IsValid()) {
+    ROOT::Minuit2::MnHesse hesse;
+    hesse(function, minimum);
+  }
+
+  for (size_t i = 0; i < parValueVec.size(); ++i) {
+    parValueVec[i] = minimum.UserState().Value(i);
+    parErrorVec[i] = parFixedVec[i] ? 0. : minimum.UserState().Error(i);
+  }
+  minNll = minimum.Fval();
+
+  if (!minimum.IsValid()) {
+    THROW_LOG_WARNING("Throw::UnbinnedFit::fit -- Minimum is not valid: " +
+                      name);
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * \brief Get number of events in the range.
+ */
+size_t Throw::UnbinnedFit::getNevents() {
+
+  return eventVec.size();
+}
+
+/**
+ * \brief Get value of the parameter, fitted after the fit.
+ */
+double Throw::UnbinnedFit::getParameter(int i) {
+  checkParIndex(i);
+
+  return parValueVec[i];
+}
+
+/**
+ * \brief Get error of the parameter, initial step before the fit.
+ */
+double Throw::UnbinnedFit::getParError(int i) {
+  checkParIndex(i);
+
+  return parErrorVec[i];
+}
+
+/**
+ * \brief Get negative log-likelihood at the minimum.
+ */
+double Throw::UnbinnedFit::getMinNll() {
+
+  return minNll;
+}
+
+/**
+ * \brief Make function of the fitted event density, events per unit of x.
+ */
+TF1* Throw::UnbinnedFit::makeFunc() {
+
+  return makeFunc(1.);
+}
+
+/**
+ * \brief Make function of the fitted PDF scaled to the number of events.
+ *
+ * The function has the fitted parameters and errors, it's renormalized when
+ * the parameters are changed. The caller owns the function.
+ *
+ * \param binWidth bin width of the histogram the function is drawn with.
+ */
+TF1* Throw::UnbinnedFit::makeFunc(double binWidth) {
+  // Normalization is cached for the last parameters, the cache is held by
+  // value so every clone of the function gets its own copy
+  std::vector<double> cacheParams(parValueVec);
+  double cacheNorm = Integrate(pdf, parValueVec.data(), xMin, xMax);
+  double scale = eventVec.size() * binWidth;
+  auto func = [pdf = pdf, xMin = xMin, xMax = xMax, scale, cacheParams,
+               cacheNorm](const double* x, const double* p) mutable {
+    if (!std::equal(cacheParams.begin(), cacheParams.end(), p)) {
+      cacheParams.assign(p, p + cacheParams.size());
+      cacheNorm = Integrate(pdf, p, xMin, xMax);
+    }
+    double value = 0.;
+    pdf(x, 1, p, &value);
+
+    return cacheNorm > 0. ? scale * value / cacheNorm : 0.;
+  };
+
+  TF1* result = new TF1(name.c_str(), func, xMin, xMax, parValueVec.size());
+  for (size_t i = 0; i < parValueVec.size(); ++i) {
+    result->SetParName(i, parNameVec[i].c_str());
+    result->SetParameter(i, parValueVec[i]);
+    result->SetParError(i, parErrorVec[i]);
+  }
+  result->SetNpx(1000);
+
+  return result;
+}